@@ -0,0 +1,205 @@
+#include "BinaryMask.h"
+
+#include <cstring>
+
+using namespace Lightning;
+
+namespace
+{
+    // Bytes of 0 or 255 for each bit of a byte, lowest bit first
+    struct ByteExpansion
+    {
+        uint64_t bytes[256];
+
+        ByteExpansion()
+        {
+            for (int value = 0; value < 256; ++value)
+            {
+                bytes[value] = 0;
+
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    if (value & (1 << bit))
+                    {
+                        bytes[value] |= (uint64_t)0xFF << (8 * bit);
+                    }
+                }
+            }
+        }
+    };
+
+    const ByteExpansion expansion;
+
+    // One bit for each of 8 bytes, set if the byte is non-zero - first byte in the lowest bit
+    inline uint64_t PackBytes(const uint8_t* data)
+    {
+        const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+
+        uint64_t bytes;
+        std::memcpy(&bytes, data, sizeof(bytes));
+
+        // Top bit of each byte set if any bit of the byte is
+        uint64_t top = (((bytes & low7) + low7) | bytes) & ~low7;
+
+        // Gather the top bits into the top byte
+        return (top * 0x0002040810204081ULL) >> 56;
+    }
+}
+
+BinaryMask::BinaryMask()
+    : _rows(0)
+    , _cols(0)
+    , _wordsPerRow(0)
+    , _lastWordMask(0)
+{
+}
+
+BinaryMask::BinaryMask(const cv::Mat& mask)
+    : BinaryMask()
+{
+    Pack(mask);
+}
+
+void BinaryMask::Pack(const cv::Mat& mask)
+{
+    CV_Assert(mask.type() == CV_8UC1);
+
+    _rows = mask.rows;
+    _cols = mask.cols;
+    _wordsPerRow = (_cols + 63) / 64;
+    _lastWordMask = (_cols % 64) ? ((uint64_t)1 << (_cols % 64)) - 1 : ~(uint64_t)0;
+
+    _bits.assign((size_t)_rows * _wordsPerRow, 0);
+    _scratch.resize(_bits.size());
+
+    for (int y = 0; y < _rows; ++y)
+    {
+        const uint8_t* source = mask.ptr<uint8_t>(y);
+        uint64_t* row = &_bits[(size_t)y * _wordsPerRow];
+
+        int x = 0;
+
+        for (; x + 8 <= _cols; x += 8)
+        {
+            row[x / 64] |= PackBytes(source + x) << (x % 64);
+        }
+
+        for (; x < _cols; ++x)
+        {
+            if (source[x])
+            {
+                row[x / 64] |= (uint64_t)1 << (x % 64);
+            }
+        }
+    }
+}
+
+void BinaryMask::Unpack(cv::Mat& mask, const cv::Range& rows) const
+{
+    cv::Range range = rows == cv::Range::all() ? cv::Range(0, _rows) : rows;
+
+    CV_Assert(range.start >= 0 && range.end <= _rows);
+
+    mask.create(range.size(), _cols, CV_8UC1);
+
+    for (int y = range.start; y < range.end; ++y)
+    {
+        uint8_t* destination = mask.ptr<uint8_t>(y - range.start);
+        const uint64_t* row = &_bits[(size_t)y * _wordsPerRow];
+
+        int x = 0;
+
+        for (; x + 8 <= _cols; x += 8)
+        {
+            std::memcpy(destination + x, &expansion.bytes[(row[x / 64] >> (x % 64)) & 0xFF], 8);
+        }
+
+        for (; x < _cols; ++x)
+        {
+            destination[x] = ((row[x / 64] >> (x % 64)) & 1) ? 255 : 0;
+        }
+    }
+}
+
+void BinaryMask::Dilate(int iterations)
+{
+    for (int i = 0; i < iterations; ++i)
+    {
+        Horizontal(true);
+        Vertical(true);
+    }
+}
+
+void BinaryMask::Erode(int iterations)
+{
+    for (int i = 0; i < iterations; ++i)
+    {
+        Horizontal(false);
+        Vertical(false);
+    }
+}
+
+void BinaryMask::Close(int iterations)
+{
+    Dilate(iterations);
+    Erode(iterations);
+}
+
+void BinaryMask::Horizontal(bool dilate)
+{
+    if (_wordsPerRow == 0)
+    {
+        return;
+    }
+
+    // Outside the image is clear for dilate and set for erode, as with the OpenCV default border
+    const uint64_t outside = dilate ? 0 : ~(uint64_t)0;
+    const uint64_t padding = dilate ? 0 : ~_lastWordMask;
+    const int last = _wordsPerRow - 1;
+
+    for (int y = 0; y < _rows; ++y)
+    {
+        const uint64_t* row = &_bits[(size_t)y * _wordsPerRow];
+        uint64_t* result = &_scratch[(size_t)y * _wordsPerRow];
+
+        uint64_t previous = outside;
+        uint64_t current = row[0] | (last == 0 ? padding : 0);
+
+        for (int w = 0; w <= last; ++w)
+        {
+            uint64_t next = w < last ? row[w + 1] | (w + 1 == last ? padding : 0) : outside;
+
+            // Bit x of left is pixel x - 1, and of right is pixel x + 1
+            uint64_t left = (current << 1) | (previous >> 63);
+            uint64_t right = (current >> 1) | (next << 63);
+
+            result[w] = dilate ? (current | left | right) : (current & left & right);
+
+            previous = current;
+            current = next;
+        }
+
+        result[last] &= _lastWordMask;
+    }
+}
+
+void BinaryMask::Vertical(bool dilate)
+{
+    const uint64_t outside = dilate ? 0 : ~(uint64_t)0;
+
+    for (int y = 0; y < _rows; ++y)
+    {
+        const uint64_t* above = y > 0 ? &_scratch[(size_t)(y - 1) * _wordsPerRow] : nullptr;
+        const uint64_t* row = &_scratch[(size_t)y * _wordsPerRow];
+        const uint64_t* below = y < _rows - 1 ? &_scratch[(size_t)(y + 1) * _wordsPerRow] : nullptr;
+        uint64_t* result = &_bits[(size_t)y * _wordsPerRow];
+
+        for (int w = 0; w < _wordsPerRow; ++w)
+        {
+            uint64_t up = above ? above[w] : outside;
+            uint64_t down = below ? below[w] : outside;
+
+            result[w] = dilate ? (row[w] | up | down) : (row[w] & up & down);
+        }
+    }
+}
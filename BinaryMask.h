@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace Lightning
+{
+
+// Mask with one bit per pixel, packed 64 pixels to a word. Dilate and erode with the 3x3
+// square work a whole word at a time, and give the same result as cv::dilate and cv::erode
+// with their default borders.
+class BinaryMask
+{
+public:
+
+    BinaryMask();
+
+    // Pack an 8-bit mask - any non-zero pixel is set
+    explicit BinaryMask(const cv::Mat&);
+
+    // Pack an 8-bit mask - any non-zero pixel is set
+    void Pack(const cv::Mat&);
+
+    // Unpack rows to an 8-bit mask of 0 and 255, as findContours expects
+    void Unpack(cv::Mat&, const cv::Range& rows = cv::Range::all()) const;
+
+    void Dilate(int iterations);
+
+    void Erode(int iterations);
+
+    // Dilate then erode - the same as MORPH_CLOSE
+    void Close(int iterations);
+
+    cv::Size GetSize() const { return cv::Size(_cols, _rows); }
+
+private:
+
+    // Combine each pixel with its left and right neighbours, from _bits into _scratch
+    void Horizontal(bool dilate);
+
+    // Combine each pixel with the pixels above and below, from _scratch into _bits
+    void Vertical(bool dilate);
+
+    int _rows;
+    int _cols;
+    int _wordsPerRow;
+
+    // Bits of the last word in each row that are inside the image - the rest are kept clear
+    uint64_t _lastWordMask;
+
+    std::vector<uint64_t> _bits;
+    std::vector<uint64_t> _scratch;
+};
+
+}
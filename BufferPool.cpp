@@ -0,0 +1,57 @@
+#include "BufferPool.h"
+
+using namespace Lightning;
+
+BufferPool::BufferPool(int count)
+    : _buffers(count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        _freeBuffers.push_back(i);
+    }
+}
+
+int BufferPool::Acquire()
+{
+    // Blocks like a driver would if every buffer is still held downstream
+    std::unique_lock<std::mutex> lock(_mutex);
+    _available.wait(lock, [this]{ return !_freeBuffers.empty(); });
+
+    int index = _freeBuffers.back();
+    _freeBuffers.pop_back();
+    return index;
+}
+
+int BufferPool::Acquire(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (!_available.wait_for(lock, timeout, [this]{ return !_freeBuffers.empty(); }))
+    {
+        return -1;
+    }
+
+    int index = _freeBuffers.back();
+    _freeBuffers.pop_back();
+    return index;
+}
+
+void BufferPool::Requeue(int index)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _freeBuffers.push_back(index);
+    }
+    _available.notify_one();
+}
+
+void BufferPool::Attach(Frame& frame, int index)
+{
+    cv::Mat& buffer = _buffers[index];
+
+    frame.image = cv::Mat(buffer.size(), buffer.type(), buffer.data, buffer.step);
+
+    std::shared_ptr<BufferPool> pool = shared_from_this();
+
+    frame.buffer = std::shared_ptr<void>(buffer.data, [pool, index](void*) { pool->Requeue(index); });
+}
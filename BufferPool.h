@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include <opencv2/opencv.hpp>
+
+#include "Frame.h"
+
+namespace Lightning
+{
+
+// Fixed set of reused image buffers lent to frames and returned when the frames are
+// released - the software equivalent of a driver's buffer queue. Create with make_shared.
+class BufferPool : public std::enable_shared_from_this<BufferPool>
+{
+public:
+
+    BufferPool(int);
+
+    // Wait for a free buffer and return its index
+    int Acquire();
+
+    // Wait up to the timeout for a free buffer - returns -1 if none came free
+    int Acquire(std::chrono::milliseconds);
+
+    // Return a buffer that was acquired but not attached to a frame
+    void Requeue(int);
+
+    cv::Mat& GetBuffer(int index) { return _buffers[index]; }
+
+    // Point the frame at the buffer - the buffer returns to the pool when the frame is released
+    void Attach(Frame&, int);
+
+private:
+
+    std::mutex _mutex;
+    std::condition_variable _available;
+
+    std::vector<cv::Mat> _buffers;
+    std::vector<int> _freeBuffers;
+};
+
+}
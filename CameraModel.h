@@ -19,10 +19,33 @@ public:
     cv::Mat GetCameraMatrix() const { return _cameraMatrix; }
     cv::Mat GetDistanceCoefficients() const { return _distanceCoefficients; }
 
+    // Camera matrix for images of the given size - the calibration is scaled for other resolutions of the same sensor
+    cv::Mat GetCameraMatrix(const cv::Size& imageSize) const
+    {
+        if (_imageSize.empty() || imageSize == _imageSize)
+        {
+            return _cameraMatrix;
+        }
+
+        double scaleX = (double)imageSize.width / _imageSize.width;
+        double scaleY = (double)imageSize.height / _imageSize.height;
+
+        cv::Mat scaled = _cameraMatrix.clone();
+        scaled.at<double>(0,0) *= scaleX;
+        scaled.at<double>(0,2) = (scaled.at<double>(0,2) + 0.5) * scaleX - 0.5;
+        scaled.at<double>(1,1) *= scaleY;
+        scaled.at<double>(1,2) = (scaled.at<double>(1,2) + 0.5) * scaleY - 0.5;
+
+        return scaled;
+    }
+
 protected:
     cv::Mat _cameraMatrix;
     cv::Mat _distanceCoefficients;
 
+    // Image size the camera was calibrated at
+    cv::Size _imageSize;
+
 };
 
 }
\ No newline at end of file
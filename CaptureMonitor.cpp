@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <numeric>
+
+#include "CaptureMonitor.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Limit on intervals kept between collections, in case nothing collects them
+    const size_t MaxIntervals = 10000;
+
+    double Milliseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+CaptureMonitor::CaptureMonitor()
+    : _hasLastFrame(false)
+    , _lastSequence(0)
+    , _frames(0)
+    , _sequenceGaps(0)
+    , _readLatencyTotal(0)
+    , _readLatencyMax(0)
+{
+}
+
+void CaptureMonitor::Reset()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _hasLastFrame = false;
+}
+
+void CaptureMonitor::Record(const Frame& frame, std::chrono::steady_clock::time_point readTime)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    ++_frames;
+
+    if (_hasLastFrame)
+    {
+        if (_intervals.size() < MaxIntervals)
+        {
+            _intervals.push_back(Milliseconds(frame.timestamp - _lastTimestamp));
+        }
+
+        if (frame.sequence > _lastSequence + 1)
+        {
+            _sequenceGaps += frame.sequence - _lastSequence - 1;
+        }
+    }
+
+    double readLatency = Milliseconds(readTime - frame.timestamp);
+
+    _readLatencyTotal += readLatency;
+    _readLatencyMax = std::max(_readLatencyMax, readLatency);
+
+    _hasLastFrame = true;
+    _lastSequence = frame.sequence;
+    _lastTimestamp = frame.timestamp;
+}
+
+CaptureStatistics CaptureMonitor::Collect()
+{
+    std::vector<double> intervals;
+    CaptureStatistics statistics;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        intervals.swap(_intervals);
+
+        statistics.frames = _frames;
+        statistics.sequenceGaps = _sequenceGaps;
+        statistics.meanReadLatency = _frames > 0 ? _readLatencyTotal / _frames : 0;
+        statistics.maxReadLatency = _readLatencyMax;
+
+        _frames = 0;
+        _sequenceGaps = 0;
+        _readLatencyTotal = 0;
+        _readLatencyMax = 0;
+    }
+
+    // Sort outside the lock so the capture thread is never held up
+    if (!intervals.empty())
+    {
+        statistics.meanInterval = std::accumulate(intervals.begin(), intervals.end(), 0.0) / intervals.size();
+        statistics.maxInterval = *std::max_element(intervals.begin(), intervals.end());
+
+        auto p99 = intervals.begin() + (intervals.size() * 99) / 100;
+        std::nth_element(intervals.begin(), p99, intervals.end());
+        statistics.p99Interval = *p99;
+    }
+
+    return statistics;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "CaptureStatistics.hpp"
+#include "Frame.h"
+
+namespace Lightning
+{
+
+// Tracks frame intervals, sequence gaps and read latency on the capture thread, and hands
+// out statistics for the window since they were last collected
+class CaptureMonitor
+{
+public:
+
+    CaptureMonitor();
+
+    // Forget the previous frame - sequence numbers restart when a source is reopened
+    void Reset();
+
+    // Record a frame and the time the capture thread read it
+    void Record(const Frame&, std::chrono::steady_clock::time_point);
+
+    // Statistics since the last call, starting a new window
+    CaptureStatistics Collect();
+
+private:
+
+    std::mutex _mutex;
+
+    bool _hasLastFrame;
+    uint64_t _lastSequence;
+    std::chrono::steady_clock::time_point _lastTimestamp;
+
+    uint64_t _frames;
+    uint64_t _sequenceGaps;
+    std::vector<double> _intervals;
+    double _readLatencyTotal;
+    double _readLatencyMax;
+};
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "json.hpp"
+
+namespace Lightning
+{
+
+// Capture timing over a reporting window, for telling where frames are being lost
+class CaptureStatistics
+{
+public:
+
+    // Frames read from the source
+    uint64_t frames = 0;
+
+    // Time between consecutive frame timestamps in milliseconds
+    double meanInterval = 0;
+    double p99Interval = 0;
+    double maxInterval = 0;
+
+    // Frames missing from the source's sequence numbers - lost before the capture thread read them
+    uint64_t sequenceGaps = 0;
+
+    // Time from capture to the capture thread reading the frame in milliseconds - grows when the capture loop falls behind
+    double meanReadLatency = 0;
+    double maxReadLatency = 0;
+
+    // Frames replaced in the mailbox before processing took them
+    uint64_t processingDrops = 0;
+};
+
+inline void to_json(nlohmann::json& j, const CaptureStatistics& d) {
+    j = nlohmann::json{{"frames", d.frames},
+    {"meanInterval_ms", d.meanInterval},
+    {"p99Interval_ms", d.p99Interval},
+    {"maxInterval_ms", d.maxInterval},
+    {"sequenceGaps", d.sequenceGaps},
+    {"meanReadLatency_ms", d.meanReadLatency},
+    {"maxReadLatency_ms", d.maxReadLatency},
+    {"processingDrops", d.processingDrops}};
+}
+
+inline void from_json(const nlohmann::json& j, CaptureStatistics& d) {
+    j.at("frames").get_to(d.frames);
+    j.at("meanInterval_ms").get_to(d.meanInterval);
+    j.at("p99Interval_ms").get_to(d.p99Interval);
+    j.at("maxInterval_ms").get_to(d.maxInterval);
+    j.at("sequenceGaps").get_to(d.sequenceGaps);
+    j.at("meanReadLatency_ms").get_to(d.meanReadLatency);
+    j.at("maxReadLatency_ms").get_to(d.maxReadLatency);
+    j.at("processingDrops").get_to(d.processingDrops);
+}
+
+}
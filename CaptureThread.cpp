@@ -0,0 +1,196 @@
+#include "CaptureThread.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Reconnect backoff - doubles after each failed open or read, reset by the next good frame
+    const std::chrono::milliseconds InitialReconnectDelay(250);
+    const std::chrono::milliseconds MaxReconnectDelay(8000);
+}
+
+CaptureThread::CaptureThread(std::vector<spdlog::sink_ptr> sinks, std::string name, std::shared_ptr<FrameSource> source)
+    : _source(source)
+    , _reportedDropCount(0)
+    , _dropFrames(source->IsLive())
+    , _reconnectDelay(InitialReconnectDelay)
+    , _doCapture(false)
+    , _isRunning(false)
+    , _isConnected(false)
+{
+    _logger = std::make_shared<spdlog::logger>(name + "Capture", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+}
+
+CaptureThread::~CaptureThread()
+{
+    Stop();
+}
+
+void CaptureThread::SetRecorder(std::unique_ptr<FrameRecorder> recorder)
+{
+    _recorder = std::move(recorder);
+}
+
+bool CaptureThread::Start()
+{
+    if (_isRunning)
+    {
+        _logger->info("CaptureThread is already running.");
+        return false;
+    }
+
+    _doCapture = true;
+    _isRunning = true;
+
+    _thread = std::thread(&CaptureThread::Run, this);
+
+    return true;
+}
+
+void CaptureThread::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_stopMutex);
+        _doCapture = false;
+    }
+    _stopCondition.notify_all();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+}
+
+std::unique_ptr<Frame> CaptureThread::WaitForFrame(std::chrono::milliseconds timeout)
+{
+    return _mailbox.WaitAndTake(timeout);
+}
+
+CaptureStatistics CaptureThread::CollectStatistics()
+{
+    CaptureStatistics statistics = _monitor.Collect();
+
+    uint64_t dropCount = _mailbox.GetOverwrittenCount();
+    statistics.processingDrops = dropCount - _reportedDropCount;
+    _reportedDropCount = dropCount;
+
+    return statistics;
+}
+
+void CaptureThread::Run()
+{
+    _logger->debug("Enter Capture thread");
+
+    while (_doCapture)
+    {
+        if (!_source->IsOpened())
+        {
+            // Recorded sources are finished once they run out of frames
+            if (!_source->CanReconnect() || !Reconnect())
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        _isConnected = true;
+
+        // Hold off until the last frame is taken if every frame must be processed - the timeout
+        // only bounds how long a stop can go unnoticed
+        if (!_dropFrames)
+        {
+            while (_doCapture && !_mailbox.WaitUntilTaken(std::chrono::milliseconds(100)))
+            {
+            }
+        }
+
+        // Read next frame from source
+        auto frame = std::make_unique<Frame>();
+
+        bool isRead;
+
+        {
+            std::shared_lock<SettingsMutex> setupLock(Setup::GetMutex());
+            isRead = _source->Read(*frame);
+        }
+
+        if (!isRead || frame->image.empty())
+        {
+            _isConnected = false;
+            _source->Release();
+
+            // A device that opens but can't deliver frames backs off like one that won't open
+            if (_source->CanReconnect())
+            {
+                _logger->error("Invalid image - reconnecting capture in {0} ms", _reconnectDelay.count());
+
+                if (!WaitToReconnect())
+                {
+                    break;
+                }
+
+                continue;
+            }
+
+            _logger->error("Invalid image - shutting down capture");
+            break;
+        }
+
+        // Only a frame proves the device is back
+        _reconnectDelay = InitialReconnectDelay;
+
+        _monitor.Record(*frame, std::chrono::steady_clock::now());
+
+        if (_recorder)
+        {
+            _recorder->Record(*frame);
+        }
+
+        if (_mailbox.Publish(std::move(frame)))
+        {
+            _logger->trace("Frame dropped - {0} total", _mailbox.GetOverwrittenCount());
+        }
+    }
+
+    _isConnected = false;
+    _isRunning = false;
+
+    _logger->debug("Leaving Capture thread - {0} frames dropped", _mailbox.GetOverwrittenCount());
+}
+
+bool CaptureThread::Reconnect()
+{
+    _isConnected = false;
+
+    bool isOpened;
+
+    {
+        std::shared_lock<SettingsMutex> setupLock(Setup::GetMutex());
+        isOpened = _source->Open();
+    }
+
+    if (isOpened)
+    {
+        _logger->info("Capture connected");
+        _monitor.Reset();
+        return true;
+    }
+
+    _logger->warn("Failed to open capture - retrying in {0} ms", _reconnectDelay.count());
+
+    return WaitToReconnect();
+}
+
+bool CaptureThread::WaitToReconnect()
+{
+    // Sleep until the next attempt, waking early if stopped
+    std::unique_lock<std::mutex> lock(_stopMutex);
+    _stopCondition.wait_for(lock, _reconnectDelay, [this]{ return !_doCapture; });
+
+    _reconnectDelay = std::min(_reconnectDelay * 2, MaxReconnectDelay);
+
+    return _doCapture;
+}
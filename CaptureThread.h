@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "spdlog/spdlog.h"
+
+#include "Frame.h"
+#include "FrameMailbox.h"
+#include "CaptureMonitor.h"
+#include "FrameSource.h"
+#include "FrameRecorder.h"
+
+namespace Lightning
+{
+
+// Continuously reads frames from a frame source on its own thread and publishes the newest
+// one to a mailbox so processing always starts on the freshest frame available
+class CaptureThread
+{
+public:
+
+    // Frames from sources that are not live are never dropped - the thread waits for each one to be taken
+    CaptureThread(std::vector<spdlog::sink_ptr>, std::string, std::shared_ptr<FrameSource>);
+    ~CaptureThread();
+
+    // Record every frame read from the source - must be set before starting
+    void SetRecorder(std::unique_ptr<FrameRecorder>);
+
+    bool Start();
+    void Stop();
+
+    bool IsRunning() const { return _isRunning; }
+
+    // False while a device-backed source is down and being reopened
+    bool IsConnected() const { return _isConnected; }
+
+    // Take the newest frame, waiting up to the timeout for one to arrive - returns nullptr if none arrived
+    std::unique_ptr<Frame> WaitForFrame(std::chrono::milliseconds);
+
+    // Number of frames overwritten in the mailbox before processing could take them
+    uint64_t GetDroppedFrameCount() const { return _mailbox.GetOverwrittenCount(); }
+
+    // Capture timing since the last call - called from a single thread
+    CaptureStatistics CollectStatistics();
+
+private:
+
+    void Run();
+
+    // Try to reopen a device-backed source - returns false if the thread was stopped while waiting to retry
+    bool Reconnect();
+
+    // Wait out the reconnect delay and double it - returns false if the thread was stopped while waiting
+    bool WaitToReconnect();
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::shared_ptr<FrameSource> _source;
+
+    std::unique_ptr<FrameRecorder> _recorder;
+
+    FrameMailbox _mailbox;
+
+    CaptureMonitor _monitor;
+
+    // Mailbox overwrites already reported by CollectStatistics
+    uint64_t _reportedDropCount;
+
+    bool _dropFrames;
+
+    std::thread _thread;
+
+    std::chrono::milliseconds _reconnectDelay;
+
+    std::mutex _stopMutex;
+    std::condition_variable _stopCondition;
+
+    std::atomic<bool> _doCapture;
+    std::atomic<bool> _isRunning;
+    std::atomic<bool> _isConnected;
+};
+
+}
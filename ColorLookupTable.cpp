@@ -0,0 +1,177 @@
+#include "ColorLookupTable.h"
+
+using namespace Lightning;
+
+ColorLookupTable::ColorLookupTable(Space space)
+    : _space(space)
+    , _labels(false)
+{
+}
+
+bool ColorLookupTable::Update(const cv::Scalar& low, const cv::Scalar& high)
+{
+    return Build({ ColorClass{ "", low, high } }, false);
+}
+
+bool ColorLookupTable::Update(const std::vector<ColorClass>& classes)
+{
+    CV_Assert(classes.size() <= MaxClasses);
+
+    return Build(classes, true);
+}
+
+bool ColorLookupTable::Build(const std::vector<ColorClass>& classes, bool labels)
+{
+    bool changed = _table.empty() || labels != _labels || classes.size() != _classes.size();
+
+    for (size_t k = 0; !changed && k < classes.size(); ++k)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            changed |= (classes[k].low[i] != _classes[k].low[i] || classes[k].high[i] != _classes[k].high[i]);
+        }
+    }
+
+    if (!changed)
+    {
+        return false;
+    }
+
+    _classes = classes;
+    _labels = labels;
+
+    cv::Mat bgr(1, CellsPerChannel * CellsPerChannel * CellsPerChannel, CV_8UC3);
+
+    if (_space == Space::Yuv)
+    {
+        CellCentersYuv(bgr);
+    }
+    else
+    {
+        CellCentersBgr(bgr);
+    }
+
+    // Classify every cell with the same conversion and test as the BGR path
+    cv::Mat hsv;
+    cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+
+    if (!_labels)
+    {
+        cv::inRange(hsv, _classes[0].low, _classes[0].high, _table);
+    }
+    else
+    {
+        _table = cv::Mat::zeros(hsv.size(), CV_8UC1);
+
+        cv::Mat inClass;
+
+        for (size_t k = 0; k < _classes.size(); ++k)
+        {
+            cv::inRange(hsv, _classes[k].low, _classes[k].high, inClass);
+            cv::bitwise_or(_table, cv::Scalar(1 << k), _table, inClass);
+        }
+    }
+
+    return true;
+}
+
+void ColorLookupTable::CellCentersYuv(cv::Mat& bgr) const
+{
+    // Using the BT.601 conversion OpenCV applies to YUYV frames
+
+    const int half = 1 << (7 - BitsPerChannel);
+
+    for (int y = 0; y < CellsPerChannel; ++y)
+    {
+        for (int u = 0; u < CellsPerChannel; ++u)
+        {
+            for (int v = 0; v < CellsPerChannel; ++v)
+            {
+                int Y = (y << (8 - BitsPerChannel)) + half;
+                int U = (u << (8 - BitsPerChannel)) + half;
+                int V = (v << (8 - BitsPerChannel)) + half;
+
+                double luma = 1.164 * std::max(0, Y - 16);
+
+                cv::Vec3b& pixel = bgr.at<cv::Vec3b>(0, Index(Y, U, V));
+                pixel[0] = cv::saturate_cast<uchar>(luma + 2.018 * (U - 128));
+                pixel[1] = cv::saturate_cast<uchar>(luma - 0.813 * (V - 128) - 0.391 * (U - 128));
+                pixel[2] = cv::saturate_cast<uchar>(luma + 1.596 * (V - 128));
+            }
+        }
+    }
+}
+
+void ColorLookupTable::CellCentersBgr(cv::Mat& bgr) const
+{
+    const int half = 1 << (7 - BitsPerChannel);
+
+    for (int b = 0; b < CellsPerChannel; ++b)
+    {
+        for (int g = 0; g < CellsPerChannel; ++g)
+        {
+            for (int r = 0; r < CellsPerChannel; ++r)
+            {
+                int B = (b << (8 - BitsPerChannel)) + half;
+                int G = (g << (8 - BitsPerChannel)) + half;
+                int R = (r << (8 - BitsPerChannel)) + half;
+
+                bgr.at<cv::Vec3b>(0, Index(B, G, R)) = cv::Vec3b(B, G, R);
+            }
+        }
+    }
+}
+
+void ColorLookupTable::ClassifyYuyv(const cv::Mat& yuyv, cv::Mat& mask) const
+{
+    mask.create(yuyv.size(), CV_8UC1);
+
+    const uchar* table = _table.ptr<uchar>();
+
+    for (int row = 0; row < yuyv.rows; ++row)
+    {
+        const uchar* src = yuyv.ptr<uchar>(row);
+        uchar* dst = mask.ptr<uchar>(row);
+
+        // Each Y0 U Y1 V group covers two pixels that share chroma
+        for (int x = 0; x + 1 < yuyv.cols; x += 2, src += 4)
+        {
+            dst[x] = table[Index(src[0], src[1], src[3])];
+            dst[x + 1] = table[Index(src[2], src[1], src[3])];
+        }
+    }
+}
+
+void ColorLookupTable::ClassifyBgr(const cv::Mat& bgr, cv::Mat& mask) const
+{
+    mask.create(bgr.size(), CV_8UC1);
+
+    const uchar* table = _table.ptr<uchar>();
+
+    for (int row = 0; row < bgr.rows; ++row)
+    {
+        const uchar* src = bgr.ptr<uchar>(row);
+        uchar* dst = mask.ptr<uchar>(row);
+
+        for (int x = 0; x < bgr.cols; ++x, src += 3)
+        {
+            dst[x] = table[Index(src[0], src[1], src[2])];
+        }
+    }
+}
+
+void ColorLookupTable::ExtractClass(const cv::Mat& labels, int index, cv::Mat& mask)
+{
+    mask.create(labels.size(), CV_8UC1);
+
+    for (int row = 0; row < labels.rows; ++row)
+    {
+        const uchar* src = labels.ptr<uchar>(row);
+        uchar* dst = mask.ptr<uchar>(row);
+
+        for (int x = 0; x < labels.cols; ++x)
+        {
+            dst[x] = ((src[x] >> index) & 1) ? 255 : 0;
+        }
+    }
+}
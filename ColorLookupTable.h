@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace Lightning
+{
+
+// Name and HSV bounds of a color to classify
+struct ColorClass
+{
+    std::string name;
+    cv::Scalar low;
+    cv::Scalar high;
+};
+
+// Color classifier that replaces per-pixel color conversion and range testing with a
+// single table lookup. The table is indexed by YUV or BGR quantized to 6 bits per channel
+// and is built from HSV bounds, so it gives the same answer as cvtColor + inRange for each
+// cell's center. The table can also label several color classes at once, with a bit per class.
+class ColorLookupTable
+{
+public:
+
+    // Color space the table is indexed by
+    enum Space
+    {
+        Yuv,
+        Bgr
+    };
+
+    // Classes that fit in a label byte
+    static const int MaxClasses = 8;
+
+    // Each channel is quantized to this many bits, and a cell is classified by the color at its center
+    static const int BitsPerChannel = 6;
+
+    ColorLookupTable(Space);
+
+    // Rebuild the table if the HSV bounds have changed - returns true if it was rebuilt
+    bool Update(const cv::Scalar& low, const cv::Scalar& high);
+
+    // Rebuild the table to label classes if any have changed - bit k of a label is set when the
+    // color is within class k's bounds. Returns true if it was rebuilt.
+    bool Update(const std::vector<ColorClass>&);
+
+    // Set mask pixels to 255 where the YUYV image color is within the bounds, or to the label of the color
+    void ClassifyYuyv(const cv::Mat& yuyv, cv::Mat& mask) const;
+
+    // Set mask pixels to 255 where the BGR image color is within the bounds, or to the label of the color
+    void ClassifyBgr(const cv::Mat& bgr, cv::Mat& mask) const;
+
+    // Set mask pixels to 255 where the labels have the class bit set
+    static void ExtractClass(const cv::Mat& labels, int index, cv::Mat& mask);
+
+private:
+
+    static const int CellsPerChannel = 1 << BitsPerChannel;
+
+    static int Index(int c0, int c1, int c2)
+    {
+        const int shift = 8 - BitsPerChannel;
+        return ((c0 >> shift) << (2 * BitsPerChannel)) | ((c1 >> shift) << BitsPerChannel) | (c2 >> shift);
+    }
+
+    // Build the table as a mask for a single class, or as labels
+    bool Build(const std::vector<ColorClass>&, bool labels);
+
+    // BGR value at the center of each cell
+    void CellCentersYuv(cv::Mat&) const;
+    void CellCentersBgr(cv::Mat&) const;
+
+    Space _space;
+
+    // One byte per cell - 255 if the cell is in range, or the cell's label
+    cv::Mat _table;
+
+    std::vector<ColorClass> _classes;
+    bool _labels;
+};
+
+}
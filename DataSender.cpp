@@ -1,4 +1,5 @@
 #include <json.hpp>
+#include <chrono>
 #include <fstream>
 
 #include "DataSender.h"
@@ -24,6 +25,15 @@ bool DataSender::Send(const std::vector<VisionMessage>& messages)
 {   
 
     nlohmann::json j = messages;
+
+    // Stamp the send time on the same clock as the capture times so the receiver can work out each frame's age
+    int64_t sentTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    for (auto& message : j)
+    {
+        message["sentTime_us"] = sentTime;
+    }
+
     std::string s = j.dump();
 
     zmq::message_t message(s.length());
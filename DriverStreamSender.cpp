@@ -0,0 +1,69 @@
+#include <json.hpp>
+
+#include "DriverStreamSender.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+DriverStreamSender::DriverStreamSender(std::vector<spdlog::sink_ptr> sinks)
+    : _context(1)
+    , _socket(_context, ZMQ_PUB)
+{
+    _logger = std::make_shared<spdlog::logger>("DriverStreamSender", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+
+    // A slow viewer should miss frames rather than queue them up
+    _socket.setsockopt(ZMQ_SNDHWM, 2);
+
+    std::string s = std::string("tcp://*:" + std::to_string(Setup::DriverStream::Port));
+    _socket.bind(s);
+}
+
+bool DriverStreamSender::Send(const std::string& camera, const Frame& frame)
+{
+    cv::Mat bgr;
+
+    if (!frame.ConvertToBgr(bgr))
+    {
+        return false;
+    }
+
+    cv::Mat scaled;
+
+    if (Setup::DriverStream::Scale > 0 && Setup::DriverStream::Scale < 1)
+    {
+        cv::resize(bgr, scaled, cv::Size(), Setup::DriverStream::Scale, Setup::DriverStream::Scale, cv::INTER_AREA);
+    }
+    else
+    {
+        scaled = bgr;
+    }
+
+    std::vector<uint8_t> jpeg;
+    std::vector<int> parameters { cv::IMWRITE_JPEG_QUALITY, Setup::DriverStream::JpegQuality };
+
+    if (!cv::imencode(".jpg", scaled, jpeg, parameters))
+    {
+        _logger->warn("Failed to encode driver frame {0}", frame.sequence);
+        return false;
+    }
+
+    nlohmann::json j = {
+        {"camera", camera},
+        {"captureTime_us", frame.GetTimestampMicroseconds()},
+        {"sequence", frame.sequence},
+        {"width", scaled.cols},
+        {"height", scaled.rows}};
+
+    std::string s = j.dump();
+
+    zmq::message_t header(s.length());
+    std::memcpy(header.data(), s.c_str(), s.length());
+
+    zmq::message_t image(jpeg.size());
+    std::memcpy(image.data(), jpeg.data(), jpeg.size());
+
+    std::lock_guard<std::mutex> lock(_socketMutex);
+
+    return _socket.send(header, ZMQ_SNDMORE | ZMQ_DONTWAIT) && _socket.send(image, ZMQ_DONTWAIT);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <zmq.hpp>
+
+#include <opencv2/opencv.hpp>
+
+#include "spdlog/spdlog.h"
+
+#include "Frame.h"
+
+namespace Lightning
+{
+
+// Publishes driver-exposure frames as downscaled JPEGs. Each message has two parts - a JSON
+// header naming the camera and frame, then the JPEG. Shared by all cameras.
+class DriverStreamSender
+{
+
+public: 
+
+    DriverStreamSender(std::vector<spdlog::sink_ptr>);
+
+    bool Send(const std::string&, const Frame&);
+
+private:
+    std::shared_ptr<spdlog::logger> _logger;
+
+    zmq::context_t _context;
+    zmq::socket_t _socket;
+
+    // The socket is used from each camera's processing thread
+    std::mutex _socketMutex;
+};
+
+}
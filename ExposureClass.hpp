@@ -0,0 +1,10 @@
+#pragma once
+
+namespace Lightning
+{
+    enum ExposureClass
+    {
+        TargetExposure,
+        DriverExposure
+    };
+}
@@ -0,0 +1,85 @@
+#include <opencv2/opencv.hpp>
+
+#include "FileFrameSource.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Same depth as the V4L2 buffer queue
+    const int BufferCount = 4;
+}
+
+FileFrameSource::FileFrameSource(std::vector<spdlog::sink_ptr> sinks, std::string path)
+    : _path(path)
+    , _frameRate(0)
+    , _sequence(0)
+{
+    _logger = std::make_shared<spdlog::logger>("FileFrameSource", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+}
+
+FileFrameSource::~FileFrameSource()
+{
+    Release();
+}
+
+bool FileFrameSource::Open()
+{
+    _capture = std::make_unique<cv::VideoCapture>(_path);
+
+    if (!_capture->isOpened())
+    {
+        _logger->error("Failed to open {0}", _path);
+        return false;
+    }
+
+    _size = cv::Size((int)_capture->get(cv::CAP_PROP_FRAME_WIDTH), (int)_capture->get(cv::CAP_PROP_FRAME_HEIGHT));
+    _frameRate = _capture->get(cv::CAP_PROP_FPS);
+
+    _logger->info("Opened {0} {1}x{2}@{3}", _path, _size.width, _size.height, _frameRate);
+
+    _pool = std::make_shared<BufferPool>(BufferCount);
+
+    return true;
+}
+
+bool FileFrameSource::IsOpened() const
+{
+    return _capture && _capture->isOpened();
+}
+
+bool FileFrameSource::Read(Frame& frame)
+{
+    if (!IsOpened())
+    {
+        return false;
+    }
+
+    int index = _pool->Acquire();
+
+    // Decoding into the same Mat reuses its memory once the first frame has been read
+    cv::Mat& buffer = _pool->GetBuffer(index);
+
+    if (!_capture->read(buffer) || buffer.empty())
+    {
+        _pool->Requeue(index);
+        return false;
+    }
+
+    _pool->Attach(frame, index);
+    frame.format = PixelFormat::BGR;
+    frame.timestamp = std::chrono::steady_clock::now();
+    frame.sequence = _sequence++;
+
+    return true;
+}
+
+void FileFrameSource::Release()
+{
+    if (_capture)
+    {
+        _capture->release();
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+
+#include "spdlog/spdlog.h"
+
+#include "FrameSource.h"
+#include "BufferPool.h"
+
+namespace cv
+{
+class VideoCapture;
+}
+
+namespace Lightning
+{
+
+// Reads a test image or video through OpenCV into a fixed pool of reused buffers, handing
+// frames out the same way V4L2FrameSource does so the pipeline can be exercised without a camera
+class FileFrameSource : public FrameSource
+{
+public:
+
+    FileFrameSource(std::vector<spdlog::sink_ptr>, std::string);
+    ~FileFrameSource();
+
+    virtual bool Open();
+
+    virtual bool IsOpened() const;
+
+    virtual bool Read(Frame&);
+
+    virtual void Release();
+
+    virtual cv::Size GetFrameSize() const { return _size; }
+
+    virtual double GetFrameRate() const { return _frameRate; }
+
+    virtual bool IsLive() const { return false; }
+
+    virtual bool CanReconnect() const { return false; }
+
+private:
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::unique_ptr<cv::VideoCapture> _capture;
+
+    std::shared_ptr<BufferPool> _pool;
+
+    std::string _path;
+
+    cv::Size _size;
+    double _frameRate;
+
+    uint64_t _sequence;
+};
+
+}
@@ -0,0 +1,77 @@
+#include <cstring>
+
+#include "Frame.h"
+
+using namespace Lightning;
+
+bool Frame::ConvertToBgr(cv::Mat& bgr) const
+{
+    if (image.empty())
+    {
+        return false;
+    }
+
+    switch (format)
+    {
+        case PixelFormat::BGR:
+            bgr = image;
+            break;
+
+        case PixelFormat::YUYV:
+            cv::cvtColor(image, bgr, cv::COLOR_YUV2BGR_YUYV);
+            break;
+
+        case PixelFormat::MJPG:
+            bgr = cv::imdecode(image, cv::IMREAD_COLOR);
+            break;
+
+        case PixelFormat::GREY:
+            cv::cvtColor(image, bgr, cv::COLOR_GRAY2BGR);
+            break;
+
+        default:
+            return false;
+    }
+
+    return !bgr.empty();
+}
+
+uint64_t Frame::GetFingerprint() const
+{
+    // FNV-1a over every fourth row, a word at a time - cheap next to processing, and
+    // live sensor noise changes the sampled rows of any genuinely new frame
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    auto mix = [&hash, prime](uint64_t value)
+    {
+        hash ^= value;
+        hash *= prime;
+    };
+
+    mix(static_cast<uint64_t>(format));
+    mix(static_cast<uint64_t>(image.cols));
+    mix(static_cast<uint64_t>(image.rows));
+
+    size_t rowBytes = image.cols * image.elemSize();
+
+    for (int y = 0; y < image.rows; y += 4)
+    {
+        const uint8_t* row = image.ptr<uint8_t>(y);
+        size_t x = 0;
+
+        for (; x + sizeof(uint64_t) <= rowBytes; x += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, row + x, sizeof(word));
+            mix(word);
+        }
+
+        for (; x < rowBytes; ++x)
+        {
+            mix(row[x]);
+        }
+    }
+
+    return hash;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include <opencv2/opencv.hpp>
+
+#include "ExposureClass.hpp"
+#include "PixelFormat.hpp"
+
+namespace Lightning
+{
+
+class Frame
+{
+public:
+    // Image as delivered by the source - may reference memory owned by the source
+    cv::Mat image;
+
+    // Layout of the image data
+    PixelFormat format = PixelFormat::BGR;
+
+    // Monotonic time the frame was captured - the driver timestamp when available
+    std::chrono::steady_clock::time_point timestamp;
+
+    // Frame sequence number from the source
+    uint64_t sequence = 0;
+
+    // True if the sequence number comes from the capture device, so each new number is a new capture.
+    // Other sources number every read, even of the same image.
+    bool deviceSequence = false;
+
+    // Exposure the frame was captured with - only target exposures are searched for targets
+    ExposureClass exposure = ExposureClass::TargetExposure;
+
+    // Ground-truth camera-to-target transform for synthetic frames - empty otherwise
+    cv::Mat truthRvec;
+    cv::Mat truthTvec;
+
+    // Keeps source-owned image memory alive and returns it to the source when the frame is released
+    std::shared_ptr<void> buffer;
+
+    // Convert the image to BGR, without copying if it is already BGR
+    bool ConvertToBgr(cv::Mat&) const;
+
+    // Hash of a sparse sample of the image - identical frames always give the same value
+    uint64_t GetFingerprint() const;
+
+    // Capture timestamp in microseconds on the steady clock
+    int64_t GetTimestampMicroseconds() const { return std::chrono::duration_cast<std::chrono::microseconds>(timestamp.time_since_epoch()).count(); }
+};
+
+}
@@ -0,0 +1,79 @@
+#include "FrameMailbox.h"
+
+using namespace Lightning;
+
+FrameMailbox::FrameMailbox()
+    : _slot(nullptr)
+    , _overwrittenCount(0)
+{
+}
+
+FrameMailbox::~FrameMailbox()
+{
+    delete _slot.exchange(nullptr);
+}
+
+bool FrameMailbox::Publish(std::unique_ptr<Frame> frame)
+{
+    Frame* previous = _slot.exchange(frame.release(), std::memory_order_acq_rel);
+
+    bool overwritten = (previous != nullptr);
+
+    if (overwritten)
+    {
+        // Consumer never saw this one
+        delete previous;
+        ++_overwrittenCount;
+    }
+
+    // Taking the lock before notifying ensures a consumer that just found the slot empty is already waiting
+    {
+        std::lock_guard<std::mutex> lock(_waitMutex);
+    }
+    _waitCondition.notify_one();
+
+    return overwritten;
+}
+
+std::unique_ptr<Frame> FrameMailbox::Take()
+{
+    std::unique_ptr<Frame> frame(_slot.exchange(nullptr, std::memory_order_acq_rel));
+
+    if (frame)
+    {
+        // As in Publish, a producer that just found the slot full is already waiting
+        {
+            std::lock_guard<std::mutex> lock(_waitMutex);
+        }
+        _takenCondition.notify_one();
+    }
+
+    return frame;
+}
+
+std::unique_ptr<Frame> FrameMailbox::WaitAndTake(std::chrono::milliseconds timeout)
+{
+    std::unique_ptr<Frame> frame = Take();
+
+    if (frame)
+    {
+        return frame;
+    }
+
+    std::unique_lock<std::mutex> lock(_waitMutex);
+    _waitCondition.wait_for(lock, timeout, [this]{ return !IsEmpty(); });
+    lock.unlock();
+
+    return Take();
+}
+
+bool FrameMailbox::WaitUntilTaken(std::chrono::milliseconds timeout)
+{
+    if (IsEmpty())
+    {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(_waitMutex);
+    return _takenCondition.wait_for(lock, timeout, [this]{ return IsEmpty(); });
+}
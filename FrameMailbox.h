@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "Frame.h"
+
+namespace Lightning
+{
+
+// Single-slot mailbox that only ever holds the newest frame. Publishing and taking
+// are a single atomic exchange; the mutex is only used to park an idle consumer, or a
+// producer waiting for its frame to be taken.
+class FrameMailbox
+{
+public:
+
+    FrameMailbox();
+    ~FrameMailbox();
+
+    // Replace the frame in the slot - returns true if an untaken frame was overwritten
+    bool Publish(std::unique_ptr<Frame>);
+
+    // Take the frame from the slot, or nullptr if it is empty
+    std::unique_ptr<Frame> Take();
+
+    // Take the frame from the slot, waiting up to the timeout for one to arrive
+    std::unique_ptr<Frame> WaitAndTake(std::chrono::milliseconds);
+
+    // Wait up to the timeout for the slot to be emptied - returns true if it is empty
+    bool WaitUntilTaken(std::chrono::milliseconds);
+
+    bool IsEmpty() const { return _slot.load(std::memory_order_acquire) == nullptr; }
+
+    uint64_t GetOverwrittenCount() const { return _overwrittenCount; }
+
+private:
+
+    std::atomic<Frame*> _slot;
+
+    std::atomic<uint64_t> _overwrittenCount;
+
+    std::mutex _waitMutex;
+    std::condition_variable _waitCondition;
+    std::condition_variable _takenCondition;
+};
+
+}
@@ -0,0 +1,188 @@
+#include <cstring>
+
+#include "FrameRecorder.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Frames waiting to be written before new ones are dropped
+    const size_t MaxQueuedFrames = 8;
+}
+
+FrameRecorder::FrameRecorder(std::vector<spdlog::sink_ptr> sinks, std::string path)
+    : _path(path)
+    , _header {}
+    , _doWrite(true)
+    , _droppedCount(0)
+{
+    _logger = std::make_shared<spdlog::logger>("FrameRecorder", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+
+    _file.open(_path, std::ios::binary | std::ios::trunc);
+
+    if (!_file.is_open())
+    {
+        _logger->error("Failed to open recording {0}", _path);
+        return;
+    }
+
+    _thread = std::thread(&FrameRecorder::Run, this);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    Close();
+}
+
+bool FrameRecorder::Record(const Frame& frame)
+{
+    if (!_file.is_open() || frame.image.empty())
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+
+        if (_queue.size() >= MaxQueuedFrames)
+        {
+            ++_droppedCount;
+            return false;
+        }
+
+        if (!_freeBuffers.empty())
+        {
+            data = std::move(_freeBuffers.back());
+            _freeBuffers.pop_back();
+        }
+    }
+
+    // Copy the rows tightly packed so the frame can be released straight away
+    const cv::Mat& image = frame.image;
+    size_t rowSize = image.cols * image.elemSize();
+
+    data.resize(rowSize * image.rows);
+
+    for (int row = 0; row < image.rows; ++row)
+    {
+        std::memcpy(data.data() + row * rowSize, image.ptr(row), rowSize);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _queue.push_back(QueuedFrame { std::move(data), frame.format, image.size(), frame.GetTimestampMicroseconds(), frame.sequence });
+    }
+
+    _queueCondition.notify_one();
+
+    return true;
+}
+
+void FrameRecorder::Close()
+{
+    // Set under the lock so the writer can't check it just before it changes and miss the notify
+    {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _doWrite = false;
+    }
+
+    _queueCondition.notify_one();
+
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+
+    if (!_file.is_open())
+    {
+        return;
+    }
+
+    // Append the index and fill in the header so readers don't need to scan
+    if (!_index.empty())
+    {
+        _header.frameCount = _index.size();
+        _header.indexOffset = (uint64_t)_file.tellp();
+
+        _file.write(reinterpret_cast<const char*>(_index.data()), _index.size() * sizeof(Recording::IndexEntry));
+
+        _file.seekp(0);
+        _file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+    }
+
+    _file.close();
+
+    _logger->info("Closed recording {0}: {1} frames, {2} dropped", _path, _index.size(), _droppedCount);
+}
+
+void FrameRecorder::Run()
+{
+    while (true)
+    {
+        QueuedFrame frame;
+
+        {
+            std::unique_lock<std::mutex> lock(_queueMutex);
+            _queueCondition.wait(lock, [this]{ return !_queue.empty() || !_doWrite; });
+
+            if (_queue.empty())
+            {
+                break;
+            }
+
+            frame = std::move(_queue.front());
+            _queue.pop_front();
+        }
+
+        Write(frame);
+
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            _freeBuffers.push_back(std::move(frame.data));
+        }
+    }
+}
+
+void FrameRecorder::Write(const QueuedFrame& frame)
+{
+    // The file header is written with the first frame, once the format is known
+    if (_header.version == 0)
+    {
+        std::memcpy(_header.magic, Recording::Magic, sizeof(_header.magic));
+        _header.version = Recording::Version;
+        _header.format = frame.format;
+        _header.width = frame.size.width;
+        _header.height = frame.size.height;
+
+        _file.write(reinterpret_cast<const char*>(&_header), sizeof(_header));
+    }
+    else if (frame.format != (PixelFormat)_header.format || (frame.format != PixelFormat::MJPG && frame.size != cv::Size(_header.width, _header.height)))
+    {
+        _logger->error("Frame format changed during recording - frame not written");
+        return;
+    }
+
+    Recording::FrameHeader frameHeader { Recording::FrameMagic, (uint32_t)frame.data.size(), frame.timestamp, frame.sequence };
+
+    _file.write(reinterpret_cast<const char*>(&frameHeader), sizeof(frameHeader));
+
+    uint64_t offset = (uint64_t)_file.tellp();
+
+    _file.write(reinterpret_cast<const char*>(frame.data.data()), frame.data.size());
+
+    // Pad to keep the frame headers aligned
+    const char padding[8] = {};
+    _file.write(padding, Recording::PaddedSize(frame.data.size()) - frame.data.size());
+
+    if (!_file.good())
+    {
+        _logger->error("Failed writing to recording {0}", _path);
+        return;
+    }
+
+    _index.push_back(Recording::IndexEntry { offset, frame.timestamp, frame.sequence, frame.data.size() });
+}
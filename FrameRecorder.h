@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "spdlog/spdlog.h"
+
+#include "Frame.h"
+#include "RecordingFormat.hpp"
+
+namespace Lightning
+{
+
+// Writes frames in their source format to a raw recording with a per-frame index.
+// Frames are copied into a bounded queue and written on a background thread so a
+// slow disk never holds up capture - frames are dropped instead.
+class FrameRecorder
+{
+public:
+
+    FrameRecorder(std::vector<spdlog::sink_ptr>, std::string);
+    ~FrameRecorder();
+
+    // Queue a copy of the frame - returns false if the writer is behind and the frame was dropped
+    bool Record(const Frame&);
+
+    // Write any queued frames and the index
+    void Close();
+
+    uint64_t GetDroppedFrameCount() const { return _droppedCount; }
+
+private:
+
+    struct QueuedFrame
+    {
+        std::vector<uint8_t> data;
+        PixelFormat format;
+        cv::Size size;
+        int64_t timestamp;
+        uint64_t sequence;
+    };
+
+    void Run();
+
+    void Write(const QueuedFrame&);
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::string _path;
+
+    std::ofstream _file;
+
+    Recording::FileHeader _header;
+    std::vector<Recording::IndexEntry> _index;
+
+    std::mutex _queueMutex;
+    std::condition_variable _queueCondition;
+    std::deque<QueuedFrame> _queue;
+    std::vector<std::vector<uint8_t>> _freeBuffers;
+
+    std::thread _thread;
+
+    std::atomic<bool> _doWrite;
+    std::atomic<uint64_t> _droppedCount;
+};
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Frame.h"
+
+namespace Lightning
+{
+
+class FrameSource
+{
+
+public:
+    virtual ~FrameSource() {}
+
+    virtual bool Open() = 0;
+
+    virtual bool IsOpened() const = 0;
+
+    // Read the next frame - the frame may hold source-owned memory until it is destroyed
+    virtual bool Read(Frame&) = 0;
+
+    virtual void Release() = 0;
+
+    // Image size actually delivered by the source
+    virtual cv::Size GetFrameSize() const = 0;
+
+    // Frame rate actually delivered by the source
+    virtual double GetFrameRate() const = 0;
+
+    // Live sources only need their newest frame processed, recorded sources need every frame
+    virtual bool IsLive() const = 0;
+
+    // Device-backed sources are reopened when a read fails, others are finished
+    virtual bool CanReconnect() const = 0;
+};
+
+}
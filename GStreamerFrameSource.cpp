@@ -0,0 +1,314 @@
+#include <mutex>
+
+#include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
+
+#include "GStreamerFrameSource.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Time to wait for the pipeline to produce its first frame
+    const GstClockTime StartTimeout = 5 * GST_SECOND;
+
+    // Time to wait for a frame before treating the pipeline as stalled
+    const GstClockTime ReadTimeout = GST_SECOND;
+
+    // Keeps a sample's buffer mapped until the frame using it is released
+    struct MappedSample
+    {
+        GstSample* sample;
+        GstMapInfo map;
+
+        ~MappedSample()
+        {
+            gst_buffer_unmap(gst_sample_get_buffer(sample), &map);
+            gst_sample_unref(sample);
+        }
+    };
+}
+
+GStreamerFrameSource::GStreamerFrameSource(std::vector<spdlog::sink_ptr> sinks, std::string description)
+    : _description(description)
+    , _pipeline(nullptr)
+    , _appSink(nullptr)
+    , _pendingSample(nullptr)
+    , _live(true)
+    , _monotonicClock(false)
+    , _format(PixelFormat::BGR)
+    , _stride(0)
+    , _frameRate(0)
+    , _sequence(0)
+{
+    _logger = std::make_shared<spdlog::logger>("GStreamerFrameSource", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+
+    static std::once_flag initialized;
+    std::call_once(initialized, []{ gst_init(nullptr, nullptr); });
+}
+
+GStreamerFrameSource::~GStreamerFrameSource()
+{
+    Release();
+}
+
+bool GStreamerFrameSource::Open()
+{
+    Release();
+
+    GError* error = nullptr;
+    _pipeline = gst_parse_launch(_description.c_str(), &error);
+
+    if (error)
+    {
+        _logger->error("Failed to create pipeline {0}: {1}", _description, error->message);
+        g_error_free(error);
+        Release();
+        return false;
+    }
+
+    _appSink = gst_bin_get_by_name(GST_BIN(_pipeline), "sink");
+
+    if (!_appSink || !GST_IS_APP_SINK(_appSink))
+    {
+        _logger->error("Pipeline must end in an appsink named sink: {0}", _description);
+        Release();
+        return false;
+    }
+
+    // Hand samples over as soon as they arrive, with only a couple held at once
+    g_object_set(_appSink, "sync", FALSE, nullptr);
+    gst_app_sink_set_max_buffers(GST_APP_SINK(_appSink), 2);
+
+    GstStateChangeReturn change = gst_element_set_state(_pipeline, GST_STATE_PLAYING);
+
+    if (change == GST_STATE_CHANGE_FAILURE)
+    {
+        _logger->error("Failed to start pipeline {0}", _description);
+        Release();
+        return false;
+    }
+
+    // Live sources don't preroll. Their old frames can be dropped, but files must be read in full.
+    _live = change == GST_STATE_CHANGE_NO_PREROLL;
+    gst_app_sink_set_drop(GST_APP_SINK(_appSink), _live);
+
+    _pendingSample = gst_app_sink_try_pull_sample(GST_APP_SINK(_appSink), StartTimeout);
+
+    if (!_pendingSample || !ReadCaps(gst_sample_get_caps(_pendingSample)))
+    {
+        _logger->error("No frames from pipeline {0}", _description);
+        Release();
+        return false;
+    }
+
+    // Buffer times convert to steady_clock when the pipeline runs on the monotonic system clock
+    GstClock* clock = gst_element_get_clock(_pipeline);
+    _monotonicClock = false;
+
+    if (clock)
+    {
+        GstClockType type = GST_CLOCK_TYPE_REALTIME;
+
+        if (GST_IS_SYSTEM_CLOCK(clock))
+        {
+            g_object_get(clock, "clock-type", &type, nullptr);
+        }
+
+        _monotonicClock = GST_IS_SYSTEM_CLOCK(clock) && type == GST_CLOCK_TYPE_MONOTONIC;
+        gst_object_unref(clock);
+    }
+
+    _sequence = 0;
+
+    _logger->info("Opened pipeline {0}: {1}x{2}@{3} {4}", _description, _size.width, _size.height, _frameRate, _live ? "live" : "not live");
+
+    return true;
+}
+
+bool GStreamerFrameSource::ReadCaps(GstCaps* caps)
+{
+    if (!caps || gst_caps_get_size(caps) == 0)
+    {
+        return false;
+    }
+
+    GstStructure* structure = gst_caps_get_structure(caps, 0);
+
+    int width = 0;
+    int height = 0;
+    int numerator = 0;
+    int denominator = 1;
+
+    gst_structure_get_int(structure, "width", &width);
+    gst_structure_get_int(structure, "height", &height);
+
+    if (gst_structure_get_fraction(structure, "framerate", &numerator, &denominator) && denominator > 0)
+    {
+        _frameRate = (double)numerator / denominator;
+    }
+
+    _size = cv::Size(width, height);
+
+    if (gst_structure_has_name(structure, "image/jpeg"))
+    {
+        _format = PixelFormat::MJPG;
+        _stride = 0;
+        return true;
+    }
+
+    GstVideoInfo info;
+
+    if (!gst_video_info_from_caps(&info, caps))
+    {
+        _logger->error("Unsupported caps {0}", gst_structure_get_name(structure));
+        return false;
+    }
+
+    switch (GST_VIDEO_INFO_FORMAT(&info))
+    {
+        case GST_VIDEO_FORMAT_BGR:
+            _format = PixelFormat::BGR;
+            break;
+        case GST_VIDEO_FORMAT_YUY2:
+            _format = PixelFormat::YUYV;
+            break;
+        case GST_VIDEO_FORMAT_GRAY8:
+            _format = PixelFormat::GREY;
+            break;
+        default:
+            _logger->error("Unsupported video format {0} - convert to BGR, YUY2 or GRAY8 before the appsink", GST_VIDEO_INFO_NAME(&info));
+            return false;
+    }
+
+    _stride = GST_VIDEO_INFO_PLANE_STRIDE(&info, 0);
+
+    return true;
+}
+
+bool GStreamerFrameSource::Read(Frame& frame)
+{
+    if (!IsOpened())
+    {
+        return false;
+    }
+
+    GstSample* sample = _pendingSample;
+    _pendingSample = nullptr;
+
+    if (!sample)
+    {
+        sample = gst_app_sink_try_pull_sample(GST_APP_SINK(_appSink), ReadTimeout);
+    }
+
+    if (!sample)
+    {
+        if (gst_app_sink_is_eos(GST_APP_SINK(_appSink)))
+        {
+            _logger->info("End of stream");
+        }
+        else
+        {
+            _logger->error("Timed out waiting for frame from pipeline");
+        }
+
+        return false;
+    }
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+
+    if (!buffer || !ReadCaps(gst_sample_get_caps(sample)))
+    {
+        gst_sample_unref(sample);
+        return false;
+    }
+
+    GstMapInfo map;
+
+    if (!gst_buffer_map(buffer, &map, GST_MAP_READ))
+    {
+        _logger->error("Failed to map buffer");
+        gst_sample_unref(sample);
+        return false;
+    }
+
+    auto mapped = std::make_shared<MappedSample>();
+    mapped->sample = sample;
+    mapped->map = map;
+
+    // Buffers can carry their own stride, e.g. from hardware decoders
+    size_t stride = _stride;
+    GstVideoMeta* meta = gst_buffer_get_video_meta(buffer);
+
+    if (meta)
+    {
+        stride = meta->stride[0];
+    }
+
+    void* data = mapped->map.data;
+
+    // Wrap the mapped buffer without copying
+    switch (_format)
+    {
+        case PixelFormat::MJPG:
+            frame.image = cv::Mat(1, mapped->map.size, CV_8UC1, data);
+            break;
+        case PixelFormat::YUYV:
+            frame.image = cv::Mat(_size, CV_8UC2, data, stride);
+            break;
+        case PixelFormat::GREY:
+            frame.image = cv::Mat(_size, CV_8UC1, data, stride);
+            break;
+        default:
+            frame.image = cv::Mat(_size, CV_8UC3, data, stride);
+            break;
+    }
+
+    frame.format = _format;
+    frame.sequence = _sequence++;
+
+    // A live pipeline only delivers each buffer once
+    frame.deviceSequence = _live;
+
+    GstClockTime pts = GST_BUFFER_PTS(buffer);
+
+    if (_monotonicClock && GST_CLOCK_TIME_IS_VALID(pts))
+    {
+        frame.timestamp = std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(gst_element_get_base_time(_pipeline) + pts)));
+    }
+    else
+    {
+        frame.timestamp = std::chrono::steady_clock::now();
+    }
+
+    frame.buffer = mapped;
+
+    return true;
+}
+
+void GStreamerFrameSource::Release()
+{
+    if (_pendingSample)
+    {
+        gst_sample_unref(_pendingSample);
+        _pendingSample = nullptr;
+    }
+
+    if (_appSink)
+    {
+        gst_object_unref(_appSink);
+        _appSink = nullptr;
+    }
+
+    // Samples held by outstanding frames keep their own references
+    if (_pipeline)
+    {
+        gst_element_set_state(_pipeline, GST_STATE_NULL);
+        gst_object_unref(_pipeline);
+        _pipeline = nullptr;
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+
+#include <gst/gst.h>
+
+#include "spdlog/spdlog.h"
+
+#include "FrameSource.h"
+
+namespace Lightning
+{
+
+// Pulls frames from the appsink named "sink" in a GStreamer pipeline, so capture and decode
+// can be swapped per platform with a pipeline string. Each frame maps the sample's buffer
+// without copying, and the sample goes back to GStreamer when the frame is released.
+class GStreamerFrameSource : public FrameSource
+{
+public:
+
+    GStreamerFrameSource(std::vector<spdlog::sink_ptr>, std::string);
+    ~GStreamerFrameSource();
+
+    virtual bool Open();
+
+    virtual bool IsOpened() const { return _pipeline != nullptr; }
+
+    virtual bool Read(Frame&);
+
+    virtual void Release();
+
+    // Known once the pipeline has started - assumed live until then so a missing camera is retried
+    virtual bool IsLive() const { return _live; }
+
+    virtual bool CanReconnect() const { return _live; }
+
+    virtual cv::Size GetFrameSize() const { return _size; }
+
+    virtual double GetFrameRate() const { return _frameRate; }
+
+private:
+
+    // Read the frame layout from a sample's caps
+    bool ReadCaps(GstCaps*);
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::string _description;
+
+    GstElement* _pipeline;
+    GstElement* _appSink;
+
+    // First sample, pulled by Open to learn the frame size
+    GstSample* _pendingSample;
+
+    bool _live;
+    bool _monotonicClock;
+
+    PixelFormat _format;
+    cv::Size _size;
+    size_t _stride;
+    double _frameRate;
+
+    uint64_t _sequence;
+};
+
+}
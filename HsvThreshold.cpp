@@ -0,0 +1,220 @@
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "HsvThreshold.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Fixed-point division tables from cv::cvtColor's 8-bit BGR to HSV conversion, so
+    // saturation and hue round exactly as they would in an HSV image
+    const int HsvShift = 12;
+
+    struct DivisionTables
+    {
+        int saturation[256];
+        int hue[256];
+
+        DivisionTables()
+        {
+            saturation[0] = 0;
+            hue[0] = 0;
+
+            for (int i = 1; i < 256; ++i)
+            {
+                saturation[i] = cv::saturate_cast<int>((255 << HsvShift) / (1. * i));
+                hue[i] = cv::saturate_cast<int>((180 << HsvShift) / (6. * i));
+            }
+        }
+    };
+
+    const DivisionTables& GetDivisionTables()
+    {
+        static const DivisionTables tables;
+        return tables;
+    }
+
+    // Inclusive integer bounds, as cv::inRange uses for 8-bit images
+    struct HsvBounds
+    {
+        int lowH, highH;
+        int lowS, highS;
+        int lowV, highV;
+    };
+
+    int LowBound(double value)
+    {
+        return std::max(0, std::min(256, cvCeil(value)));
+    }
+
+    int HighBound(double value)
+    {
+        return std::max(-1, std::min(255, cvFloor(value)));
+    }
+
+    inline bool InRange(int b, int g, int r, const HsvBounds& bounds, const DivisionTables& tables)
+    {
+        int v = std::max(b, std::max(g, r));
+
+        if (v < bounds.lowV || v > bounds.highV)
+        {
+            return false;
+        }
+
+        int diff = v - std::min(b, std::min(g, r));
+        int s = (diff * tables.saturation[v] + (1 << (HsvShift - 1))) >> HsvShift;
+
+        if (s < bounds.lowS || s > bounds.highS)
+        {
+            return false;
+        }
+
+        int h;
+
+        if (v == r)
+        {
+            h = g - b;
+        }
+        else if (v == g)
+        {
+            h = b - r + 2 * diff;
+        }
+        else
+        {
+            h = r - g + 4 * diff;
+        }
+
+        h = (h * tables.hue[diff] + (1 << (HsvShift - 1))) >> HsvShift;
+        h += h < 0 ? 180 : 0;
+
+        return h >= bounds.lowH && h <= bounds.highH;
+    }
+
+#if CV_SIMD
+    struct SimdBounds
+    {
+        cv::v_int32 lowH, highH;
+        cv::v_int32 lowS, highS;
+
+        SimdBounds(const HsvBounds& bounds)
+            : lowH(cv::vx_setall_s32(bounds.lowH))
+            , highH(cv::vx_setall_s32(bounds.highH))
+            , lowS(cv::vx_setall_s32(bounds.lowS))
+            , highS(cv::vx_setall_s32(bounds.highS))
+        {
+        }
+    };
+
+    // Saturation and hue test for one quarter of a vector of pixels, widened to 32 bits
+    inline cv::v_int32 SaturationHueMask(const cv::v_int32& b, const cv::v_int32& g, const cv::v_int32& r, const cv::v_int32& v, const cv::v_int32& diff,
+        const SimdBounds& bounds, const DivisionTables& tables)
+    {
+        const cv::v_int32 half = cv::vx_setall_s32(1 << (HsvShift - 1));
+
+        cv::v_int32 s = (diff * cv::v_lut(tables.saturation, v) + half) >> HsvShift;
+
+        cv::v_int32 h = cv::v_select(v == r, g - b, cv::v_select(v == g, b - r + (diff << 1), r - g + (diff << 2)));
+        h = (h * cv::v_lut(tables.hue, diff) + half) >> HsvShift;
+        h = h + (cv::vx_setall_s32(180) & (h < cv::vx_setzero_s32()));
+
+        return (s >= bounds.lowS) & (s <= bounds.highS) & (h >= bounds.lowH) & (h <= bounds.highH);
+    }
+#endif
+
+    void ThresholdRow(const uint8_t* src, uint8_t* dst, int width, const HsvBounds& bounds, const DivisionTables& tables)
+    {
+        int x = 0;
+
+#if CV_SIMD
+        const int lanes = cv::v_uint8::nlanes;
+
+        const cv::v_uint8 lowV = cv::vx_setall_u8((uint8_t)std::max(0, std::min(255, bounds.lowV)));
+        const cv::v_uint8 highV = cv::vx_setall_u8((uint8_t)std::max(0, bounds.highV));
+        const SimdBounds simdBounds(bounds);
+
+        for (; x <= width - lanes; x += lanes)
+        {
+            cv::v_uint8 b, g, r;
+            cv::v_load_deinterleave(src + x * 3, b, g, r);
+
+            cv::v_uint8 v = cv::v_max(b, cv::v_max(g, r));
+            cv::v_uint8 diff = v - cv::v_min(b, cv::v_min(g, r));
+
+            cv::v_uint8 valueMask = (v >= lowV) & (v <= highV);
+
+            // Most of a short exposure is too dark to pass, so skip the fixed-point maths when nothing can
+            if (!cv::v_check_any(valueMask))
+            {
+                cv::v_store(dst + x, cv::vx_setzero_u8());
+                continue;
+            }
+
+            // Widen to 32 bits for the division tables, then pack the masks back down
+            cv::v_uint16 b16[2], g16[2], r16[2], v16[2], diff16[2];
+            cv::v_expand(b, b16[0], b16[1]);
+            cv::v_expand(g, g16[0], g16[1]);
+            cv::v_expand(r, r16[0], r16[1]);
+            cv::v_expand(v, v16[0], v16[1]);
+            cv::v_expand(diff, diff16[0], diff16[1]);
+
+            cv::v_int16 halfMasks[2];
+
+            for (int i = 0; i < 2; ++i)
+            {
+                cv::v_uint32 b32[2], g32[2], r32[2], v32[2], diff32[2];
+                cv::v_expand(b16[i], b32[0], b32[1]);
+                cv::v_expand(g16[i], g32[0], g32[1]);
+                cv::v_expand(r16[i], r32[0], r32[1]);
+                cv::v_expand(v16[i], v32[0], v32[1]);
+                cv::v_expand(diff16[i], diff32[0], diff32[1]);
+
+                cv::v_int32 quarterMasks[2];
+
+                for (int j = 0; j < 2; ++j)
+                {
+                    quarterMasks[j] = SaturationHueMask(
+                        cv::v_reinterpret_as_s32(b32[j]), cv::v_reinterpret_as_s32(g32[j]), cv::v_reinterpret_as_s32(r32[j]),
+                        cv::v_reinterpret_as_s32(v32[j]), cv::v_reinterpret_as_s32(diff32[j]),
+                        simdBounds, tables);
+                }
+
+                halfMasks[i] = cv::v_pack(quarterMasks[0], quarterMasks[1]);
+            }
+
+            cv::v_store(dst + x, cv::v_reinterpret_as_u8(cv::v_pack(halfMasks[0], halfMasks[1])) & valueMask);
+        }
+
+        cv::vx_cleanup();
+#endif
+
+        for (; x < width; ++x)
+        {
+            dst[x] = InRange(src[x * 3], src[x * 3 + 1], src[x * 3 + 2], bounds, tables) ? 255 : 0;
+        }
+    }
+}
+
+void Lightning::ThresholdHsv(const cv::Mat& bgr, const cv::Scalar& low, const cv::Scalar& high, cv::Mat& mask)
+{
+    CV_Assert(bgr.type() == CV_8UC3);
+
+    const DivisionTables& tables = GetDivisionTables();
+
+    HsvBounds bounds {
+        LowBound(low[0]), HighBound(high[0]),
+        LowBound(low[1]), HighBound(high[1]),
+        LowBound(low[2]), HighBound(high[2]) };
+
+    mask.create(bgr.size(), CV_8UC1);
+
+    if (bounds.lowH > bounds.highH || bounds.lowS > bounds.highS || bounds.lowV > bounds.highV)
+    {
+        mask.setTo(cv::Scalar(0));
+        return;
+    }
+
+    for (int y = 0; y < bgr.rows; ++y)
+    {
+        ThresholdRow(bgr.ptr<uint8_t>(y), mask.ptr<uint8_t>(y), bgr.cols, bounds, tables);
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+namespace Lightning
+{
+
+// Threshold a BGR image on HSV bounds in a single pass, without building an HSV image.
+// Selects exactly the pixels that cv::cvtColor(COLOR_BGR2HSV) followed by cv::inRange would.
+void ThresholdHsv(const cv::Mat& bgr, const cv::Scalar& low, const cv::Scalar& high, cv::Mat& mask);
+
+}
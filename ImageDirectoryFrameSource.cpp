@@ -0,0 +1,152 @@
+#include "ImageDirectoryFrameSource.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+ImageDirectoryFrameSource::ImageDirectoryFrameSource(std::vector<spdlog::sink_ptr> sinks, std::string pattern, int threads, int depth)
+    : _pattern(pattern)
+    , _threadCount(std::max(1, threads))
+    , _depth(std::max(1, depth))
+    , _nextDecode(0)
+    , _nextRead(0)
+    , _stop(false)
+{
+    _logger = std::make_shared<spdlog::logger>("ImageDirectoryFrameSource", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+}
+
+ImageDirectoryFrameSource::~ImageDirectoryFrameSource()
+{
+    Release();
+}
+
+bool ImageDirectoryFrameSource::Open()
+{
+    Release();
+
+    _files.clear();
+    cv::glob(_pattern, _files, false);
+
+    if (_files.empty())
+    {
+        _logger->error("No images match {0}", _pattern);
+        return false;
+    }
+
+    // Decode the first image up front so the frame size is known
+    cv::Mat first = cv::imread(_files[0], cv::IMREAD_COLOR);
+
+    if (first.empty())
+    {
+        _logger->error("Failed to read {0}", _files[0]);
+        return false;
+    }
+
+    _size = first.size();
+
+    _decoded.clear();
+    _decoded[0] = first;
+    _nextDecode = 1;
+    _nextRead = 0;
+    _stop = false;
+
+    for (int i = 0; i < _threadCount; ++i)
+    {
+        _workers.push_back(std::thread(&ImageDirectoryFrameSource::DecodeWorker, this));
+    }
+
+    _logger->info("Opened {0}: {1} images {2}x{3}, {4} decode threads", _pattern, _files.size(), _size.width, _size.height, _threadCount);
+
+    return true;
+}
+
+void ImageDirectoryFrameSource::DecodeWorker()
+{
+    while (true)
+    {
+        size_t index;
+
+        // Claim the next image once there is room in the window
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _spaceCondition.wait(lock, [this]{ return _stop || _nextDecode >= _files.size() || _nextDecode < _nextRead + _depth; });
+
+            if (_stop || _nextDecode >= _files.size())
+            {
+                return;
+            }
+
+            index = _nextDecode++;
+        }
+
+        // An empty image marks a file that failed to decode
+        cv::Mat image = cv::imread(_files[index], cv::IMREAD_COLOR);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _decoded[index] = image;
+        }
+
+        _decodedCondition.notify_all();
+    }
+}
+
+bool ImageDirectoryFrameSource::Read(Frame& frame)
+{
+    while (true)
+    {
+        cv::Mat image;
+        size_t index;
+
+        // Images are handed out in order, whichever worker finishes first
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _decodedCondition.wait(lock, [this]{ return _stop || _nextRead >= _files.size() || _decoded.count(_nextRead) > 0; });
+
+            if (_stop || _nextRead >= _files.size())
+            {
+                return false;
+            }
+
+            index = _nextRead++;
+            image = _decoded[index];
+            _decoded.erase(index);
+        }
+
+        _spaceCondition.notify_all();
+
+        if (image.empty())
+        {
+            _logger->warn("Skipping {0} - failed to decode", _files[index]);
+            continue;
+        }
+
+        frame.image = image;
+        frame.format = PixelFormat::BGR;
+        frame.timestamp = std::chrono::steady_clock::now();
+        frame.sequence = index;
+
+        return true;
+    }
+}
+
+void ImageDirectoryFrameSource::Release()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _spaceCondition.notify_all();
+    _decodedCondition.notify_all();
+
+    for (auto& worker : _workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+
+    _workers.clear();
+}
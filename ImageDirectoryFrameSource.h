@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "spdlog/spdlog.h"
+
+#include "FrameSource.h"
+
+namespace Lightning
+{
+
+// Reads every image matching a directory or glob pattern in name order. A small pool of
+// workers decodes ahead of the pipeline into a bounded window, so evaluating large sets
+// of logged images is limited by processing rather than by decode.
+class ImageDirectoryFrameSource : public FrameSource
+{
+public:
+
+    ImageDirectoryFrameSource(std::vector<spdlog::sink_ptr>, std::string, int threads, int depth);
+    ~ImageDirectoryFrameSource();
+
+    virtual bool Open();
+
+    virtual bool IsOpened() const { return !_workers.empty(); }
+
+    virtual bool Read(Frame&);
+
+    virtual void Release();
+
+    virtual bool IsLive() const { return false; }
+
+    virtual bool CanReconnect() const { return false; }
+
+    virtual cv::Size GetFrameSize() const { return _size; }
+
+    virtual double GetFrameRate() const { return 0; }
+
+private:
+
+    void DecodeWorker();
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::string _pattern;
+    std::vector<std::string> _files;
+
+    int _threadCount;
+    int _depth;
+
+    std::vector<std::thread> _workers;
+
+    // Decoded images waiting to be read, keyed by file index
+    std::map<size_t, cv::Mat> _decoded;
+
+    size_t _nextDecode;
+    size_t _nextRead;
+    bool _stop;
+
+    std::mutex _mutex;
+    std::condition_variable _decodedCondition;
+    std::condition_variable _spaceCondition;
+
+    cv::Size _size;
+};
+
+}
@@ -0,0 +1,104 @@
+#include <csetjmp>
+#include <cstdio>
+
+extern "C"
+{
+#include <jpeglib.h>
+}
+
+#include "JpegDecoder.h"
+
+using namespace Lightning;
+
+struct JpegDecoder::Decompressor
+{
+    jpeg_decompress_struct info;
+    jpeg_error_mgr error;
+    std::jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+
+    Decompressor()
+    {
+        info.err = jpeg_std_error(&error);
+        error.error_exit = &Decompressor::ErrorExit;
+        info.client_data = this;
+
+        jpeg_create_decompress(&info);
+    }
+
+    ~Decompressor()
+    {
+        jpeg_destroy_decompress(&info);
+    }
+
+    // The default handler calls exit() - jump back to Decode instead
+    static void ErrorExit(j_common_ptr info)
+    {
+        Decompressor* decompressor = static_cast<Decompressor*>(info->client_data);
+
+        (*info->err->format_message)(info, decompressor->message);
+
+        std::longjmp(decompressor->jump, 1);
+    }
+};
+
+JpegDecoder::JpegDecoder()
+    : _decompressor(std::make_unique<Decompressor>())
+{
+}
+
+JpegDecoder::~JpegDecoder()
+{
+}
+
+bool JpegDecoder::Decode(const uint8_t* data, size_t size, int scale, cv::Mat& bgr)
+{
+    jpeg_decompress_struct& info = _decompressor->info;
+
+    // No objects with destructors may be created between here and the end of decoding
+    if (setjmp(_decompressor->jump))
+    {
+        jpeg_abort_decompress(&info);
+        _lastError = _decompressor->message;
+        return false;
+    }
+
+    jpeg_mem_src(&info, const_cast<unsigned char*>(data), size);
+
+    if (jpeg_read_header(&info, TRUE) != JPEG_HEADER_OK)
+    {
+        jpeg_abort_decompress(&info);
+        _lastError = "Invalid JPEG header";
+        return false;
+    }
+
+    // Scale in the DCT domain - only the coefficients needed for the output size are used
+    info.scale_num = 1;
+    info.scale_denom = scale;
+    info.dct_method = JDCT_IFAST;
+    info.do_fancy_upsampling = FALSE;
+
+#ifdef JCS_EXTENSIONS
+    info.out_color_space = JCS_EXT_BGR;
+#else
+    info.out_color_space = JCS_RGB;
+#endif
+
+    jpeg_start_decompress(&info);
+
+    bgr.create(info.output_height, info.output_width, CV_8UC3);
+
+    while (info.output_scanline < info.output_height)
+    {
+        JSAMPROW row = bgr.ptr<uchar>(info.output_scanline);
+        jpeg_read_scanlines(&info, &row, 1);
+    }
+
+    jpeg_finish_decompress(&info);
+
+#ifndef JCS_EXTENSIONS
+    cv::cvtColor(bgr, bgr, cv::COLOR_RGB2BGR);
+#endif
+
+    return true;
+}
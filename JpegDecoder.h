@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <opencv2/opencv.hpp>
+
+namespace Lightning
+{
+
+// libjpeg decoder that decodes straight to a reduced size using DCT-domain scaling,
+// so decode cost scales with the output resolution rather than the sensor resolution
+class JpegDecoder
+{
+public:
+
+    JpegDecoder();
+    ~JpegDecoder();
+
+    // Decode to BGR at 1/scale of full size - scale must be 1, 2, 4 or 8
+    bool Decode(const uint8_t*, size_t, int scale, cv::Mat&);
+
+    const std::string& GetLastError() const { return _lastError; }
+
+private:
+
+    // libjpeg state, kept between frames to avoid setting it up every time
+    struct Decompressor;
+
+    std::unique_ptr<Decompressor> _decompressor;
+
+    std::string _lastError;
+};
+
+}
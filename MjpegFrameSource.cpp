@@ -0,0 +1,105 @@
+#include "MjpegFrameSource.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Same depth as the V4L2 buffer queue
+    const int BufferCount = 4;
+
+    // Corrupt frames in a row before the source is treated as failed
+    const int MaxDecodeFailures = 10;
+
+    // How long a compressed frame waits for a decode buffer before it is dropped, and how many
+    // frames in a row can be dropped before the source is treated as failed
+    const std::chrono::milliseconds DecodeBufferTimeout(50);
+    const int MaxDroppedFrames = 20;
+}
+
+MjpegFrameSource::MjpegFrameSource(std::vector<spdlog::sink_ptr> sinks, std::shared_ptr<FrameSource> source, int scale)
+    : _source(source)
+    , _pool(std::make_shared<BufferPool>(BufferCount))
+    , _scale(scale)
+{
+    _logger = std::make_shared<spdlog::logger>("MjpegFrameSource", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+
+    if (_scale != 1 && _scale != 2 && _scale != 4 && _scale != 8)
+    {
+        _logger->warn("JPEG scale must be 1, 2, 4 or 8 - using 1 instead of {0}", _scale);
+        _scale = 1;
+    }
+}
+
+bool MjpegFrameSource::Open()
+{
+    return _source->Open();
+}
+
+cv::Size MjpegFrameSource::GetFrameSize() const
+{
+    // libjpeg rounds scaled dimensions up
+    cv::Size size = _source->GetFrameSize();
+
+    return cv::Size((size.width + _scale - 1) / _scale, (size.height + _scale - 1) / _scale);
+}
+
+bool MjpegFrameSource::Read(Frame& frame)
+{
+    int failures = 0;
+    int dropped = 0;
+
+    while (failures < MaxDecodeFailures)
+    {
+        Frame compressed;
+
+        if (!_source->Read(compressed))
+        {
+            return false;
+        }
+
+        if (compressed.format != PixelFormat::MJPG)
+        {
+            frame = compressed;
+            return true;
+        }
+
+        // Don't hold the driver buffer waiting on a slow consumer - drop the frame and
+        // read the next one, as the driver does when all its buffers are taken
+        int index = _pool->Acquire(DecodeBufferTimeout);
+
+        if (index < 0)
+        {
+            if (++dropped >= MaxDroppedFrames)
+            {
+                _logger->error("No decode buffer came free for {0} frames", dropped);
+                return false;
+            }
+
+            _logger->debug("No free decode buffer - dropping frame {0}", compressed.sequence);
+            continue;
+        }
+
+        // The compressed frame goes back to its source as soon as it has been decoded
+        if (!_decoder.Decode(compressed.image.ptr<uint8_t>(), compressed.image.total(), _scale, _pool->GetBuffer(index)))
+        {
+            _pool->Requeue(index);
+            ++failures;
+            _logger->debug("Skipping corrupt frame {0}: {1}", compressed.sequence, _decoder.GetLastError());
+            continue;
+        }
+
+        _pool->Attach(frame, index);
+        frame.format = PixelFormat::BGR;
+        frame.timestamp = compressed.timestamp;
+        frame.sequence = compressed.sequence;
+        frame.deviceSequence = compressed.deviceSequence;
+        frame.exposure = compressed.exposure;
+
+        return true;
+    }
+
+    _logger->error("Too many corrupt frames");
+    return false;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+
+#include "spdlog/spdlog.h"
+
+#include "FrameSource.h"
+#include "BufferPool.h"
+#include "JpegDecoder.h"
+
+namespace Lightning
+{
+
+// Wraps another frame source and decodes its MJPEG frames to BGR at 1/2, 1/4 or 1/8
+// of full size on the capture thread. Frames in other formats pass straight through.
+class MjpegFrameSource : public FrameSource
+{
+public:
+
+    MjpegFrameSource(std::vector<spdlog::sink_ptr>, std::shared_ptr<FrameSource>, int scale);
+
+    virtual bool Open();
+
+    virtual bool IsOpened() const { return _source->IsOpened(); }
+
+    virtual bool Read(Frame&);
+
+    virtual void Release() { _source->Release(); }
+
+    virtual bool IsLive() const { return _source->IsLive(); }
+
+    virtual bool CanReconnect() const { return _source->CanReconnect(); }
+
+    virtual cv::Size GetFrameSize() const;
+
+    virtual double GetFrameRate() const { return _source->GetFrameRate(); }
+
+private:
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::shared_ptr<FrameSource> _source;
+
+    std::shared_ptr<BufferPool> _pool;
+
+    JpegDecoder _decoder;
+
+    int _scale;
+};
+
+}
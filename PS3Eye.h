@@ -14,6 +14,8 @@ public:
 
         // TODO get from camera calibration
 
+        _imageSize = cv::Size(640, 480);
+
 
         // Wide angle
         /*
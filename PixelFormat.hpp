@@ -0,0 +1,12 @@
+#pragma once
+
+namespace Lightning
+{
+    enum PixelFormat
+    {
+        BGR,
+        YUYV,
+        MJPG,
+        GREY
+    };
+}
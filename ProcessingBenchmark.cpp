@@ -0,0 +1,580 @@
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/ansicolor_sink.h"
+
+#include "Setup.h"
+#include "HsvThreshold.h"
+#include "ColorLookupTable.h"
+#include "BinaryMask.h"
+#include "TargetFinder.h"
+#include "SyntheticFrameSource.h"
+#include "RapidReactTargetModel.h"
+#include "PS3Eye.h"
+
+using namespace Lightning;
+
+// Checks the processing kernels against the OpenCV calls they replace, on synthetic frames and
+// on noise that covers every color, and times both. Each kernel has to match its reference
+// exactly - the exit code is the number of checks that failed.
+
+namespace
+{
+    std::shared_ptr<spdlog::logger> logger;
+
+    int failedChecks = 0;
+
+    // Average milliseconds per call, calling with each index from 0 to count - 1
+    template <typename Function>
+    double TimeMs(int count, Function function)
+    {
+        int64_t start = cv::getTickCount();
+
+        for (int i = 0; i < count; ++i)
+        {
+            function(i);
+        }
+
+        return 1000.0 * (cv::getTickCount() - start) / cv::getTickFrequency() / count;
+    }
+
+    int CountDifferences(const cv::Mat& expected, const cv::Mat& actual)
+    {
+        if (expected.size() != actual.size() || expected.type() != actual.type())
+        {
+            return (int)std::max(expected.total(), actual.total());
+        }
+
+        cv::Mat difference;
+        cv::compare(expected, actual, difference, cv::CMP_NE);
+
+        return cv::countNonZero(difference);
+    }
+
+    void Report(const std::string& name, double referenceMs, double kernelMs, int64_t differences)
+    {
+        logger->info("{0}: reference {1:.3f} ms, kernel {2:.3f} ms ({3:.1f}x), {4} pixels differ",
+            name, referenceMs, kernelMs, referenceMs / kernelMs, differences);
+
+        if (differences > 0)
+        {
+            logger->error("{0} does not match its reference", name);
+            ++failedChecks;
+        }
+    }
+
+    // Frames of rendered targets
+    std::vector<cv::Mat> RenderFrames(std::vector<spdlog::sink_ptr> sinks, int frameCount)
+    {
+        std::vector<cv::Mat> frames;
+
+        SyntheticFrameSource source(sinks, std::make_unique<RapidReactTargetModel>(), std::make_unique<PS3EyeModel>());
+        source.Open();
+
+        for (int i = 0; i < frameCount; ++i)
+        {
+            Frame frame;
+
+            if (source.Read(frame))
+            {
+                frames.push_back(frame.image.clone());
+            }
+        }
+
+        return frames;
+    }
+
+    // Uniform noise at the frame size, and at an odd size that leaves a partial vector at the end of every row
+    std::vector<cv::Mat> MakeNoise(const cv::Size& frameSize)
+    {
+        std::vector<cv::Mat> images;
+
+        cv::RNG rng(Setup::Synthetic::Seed);
+
+        for (cv::Size size : { frameSize, cv::Size(641, 37) })
+        {
+            cv::Mat noise(size, CV_8UC3);
+            rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+            images.push_back(noise);
+        }
+
+        return images;
+    }
+
+    // Bounds to test with - the setup file's, everything, and narrow ranges at each end of hue
+    std::vector<std::pair<cv::Scalar, cv::Scalar>> MakeBounds()
+    {
+        return
+        {
+            { cv::Scalar(Setup::HSVFilter::LowH, Setup::HSVFilter::LowS, Setup::HSVFilter::LowV),
+              cv::Scalar(Setup::HSVFilter::HighH, Setup::HSVFilter::HighS, Setup::HSVFilter::HighV) },
+            { cv::Scalar(0, 0, 0), cv::Scalar(180, 255, 255) },
+            { cv::Scalar(0, 100, 100), cv::Scalar(10, 255, 255) },
+            { cv::Scalar(170, 50, 20), cv::Scalar(180, 255, 255) }
+        };
+    }
+
+    // YUYV with BT.601 studio swing, the encoding cvtColor decodes - each pair shares the average chroma
+    cv::Mat BgrToYuyv(const cv::Mat& bgr)
+    {
+        cv::Mat yuyv(bgr.rows, bgr.cols & ~1, CV_8UC2);
+
+        for (int row = 0; row < yuyv.rows; ++row)
+        {
+            const uchar* src = bgr.ptr<uchar>(row);
+            uchar* dst = yuyv.ptr<uchar>(row);
+
+            for (int x = 0; x < yuyv.cols; x += 2, src += 6, dst += 4)
+            {
+                double u = 0, v = 0;
+
+                for (int k = 0; k < 2; ++k)
+                {
+                    double b = src[3 * k], g = src[3 * k + 1], r = src[3 * k + 2];
+
+                    dst[2 * k] = cv::saturate_cast<uchar>(16 + 0.257 * r + 0.504 * g + 0.098 * b);
+                    u += 128 - 0.148 * r - 0.291 * g + 0.439 * b;
+                    v += 128 + 0.439 * r - 0.368 * g - 0.071 * b;
+                }
+
+                dst[1] = cv::saturate_cast<uchar>(u / 2);
+                dst[3] = cv::saturate_cast<uchar>(v / 2);
+            }
+        }
+
+        return yuyv;
+    }
+
+    void CheckFusedThreshold(const std::vector<cv::Mat>& images)
+    {
+        int count = images.size();
+
+        for (auto& bounds : MakeBounds())
+        {
+            std::vector<cv::Mat> expected(count), actual(count);
+
+            double referenceMs = TimeMs(count, [&](int i)
+            {
+                cv::Mat hsv;
+                cv::cvtColor(images[i], hsv, cv::COLOR_BGR2HSV);
+                cv::inRange(hsv, bounds.first, bounds.second, expected[i]);
+            });
+
+            double kernelMs = TimeMs(count, [&](int i)
+            {
+                ThresholdHsv(images[i], bounds.first, bounds.second, actual[i]);
+            });
+
+            int64_t differences = 0;
+
+            for (int i = 0; i < count; ++i)
+            {
+                differences += CountDifferences(expected[i], actual[i]);
+            }
+
+            Report(fmt::format("Fused HSV threshold {0}-{1}", bounds.first[0], bounds.second[0]), referenceMs, kernelMs, differences);
+        }
+    }
+
+    void CheckLookupTable(const std::vector<cv::Mat>& images)
+    {
+        int count = images.size();
+
+        // The table classifies each cell by its center, so cvtColor and inRange on the image moved
+        // to the cell centers must give exactly the same mask
+        const int shift = 8 - ColorLookupTable::BitsPerChannel;
+        const cv::Scalar cellMask = cv::Scalar::all(0xFF & ~((1 << shift) - 1));
+        const cv::Scalar cellCenter = cv::Scalar::all(1 << (shift - 1));
+
+        std::vector<cv::Mat> centered(count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            cv::bitwise_and(images[i], cellMask, centered[i]);
+            cv::bitwise_or(centered[i], cellCenter, centered[i]);
+        }
+
+        for (auto& bounds : MakeBounds())
+        {
+            ColorLookupTable table(ColorLookupTable::Space::Bgr);
+
+            int64_t buildStart = cv::getTickCount();
+            table.Update(bounds.first, bounds.second);
+            double buildMs = 1000.0 * (cv::getTickCount() - buildStart) / cv::getTickFrequency();
+
+            std::vector<cv::Mat> expected(count), actual(count);
+
+            double referenceMs = TimeMs(count, [&](int i)
+            {
+                cv::Mat hsv;
+                cv::cvtColor(centered[i], hsv, cv::COLOR_BGR2HSV);
+                cv::inRange(hsv, bounds.first, bounds.second, expected[i]);
+            });
+
+            double kernelMs = TimeMs(count, [&](int i)
+            {
+                table.ClassifyBgr(images[i], actual[i]);
+            });
+
+            int64_t differences = 0;
+
+            for (int i = 0; i < count; ++i)
+            {
+                differences += CountDifferences(expected[i], actual[i]);
+            }
+
+            Report(fmt::format("BGR lookup table {0}-{1} (built in {2:.1f} ms)", bounds.first[0], bounds.second[0], buildMs), referenceMs, kernelMs, differences);
+        }
+
+        // The YUV table converts cell centers with floating point BT.601 rather than cvtColor's fixed
+        // point, so it is only timed, with how far it is from converting the frame
+        ColorLookupTable table(ColorLookupTable::Space::Yuv);
+        auto bounds = MakeBounds().front();
+
+        table.Update(bounds.first, bounds.second);
+
+        std::vector<cv::Mat> yuyv(count), expected(count), actual(count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            yuyv[i] = BgrToYuyv(images[i]);
+        }
+
+        double referenceMs = TimeMs(count, [&](int i)
+        {
+            cv::Mat bgr, hsv;
+            cv::cvtColor(yuyv[i], bgr, cv::COLOR_YUV2BGR_YUYV);
+            cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+            cv::inRange(hsv, bounds.first, bounds.second, expected[i]);
+        });
+
+        double kernelMs = TimeMs(count, [&](int i)
+        {
+            table.ClassifyYuyv(yuyv[i], actual[i]);
+        });
+
+        int64_t differences = 0;
+        int64_t total = 0;
+
+        for (int i = 0; i < count; ++i)
+        {
+            differences += CountDifferences(expected[i], actual[i]);
+            total += yuyv[i].total();
+        }
+
+        logger->info("YUV lookup table: reference {0:.3f} ms, kernel {1:.3f} ms ({2:.1f}x), {3:.3f}% of pixels classified differently",
+            referenceMs, kernelMs, referenceMs / kernelMs, 100.0 * differences / total);
+    }
+
+    void CheckBitPackedMorphology(const std::vector<cv::Mat>& images)
+    {
+        // Masks thresholded from the images, and random masks of several densities at widths either
+        // side of a whole number of words
+        std::vector<cv::Mat> masks;
+
+        auto bounds = MakeBounds().front();
+
+        for (auto& image : images)
+        {
+            cv::Mat hsv, mask;
+            cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
+            cv::inRange(hsv, bounds.first, bounds.second, mask);
+            masks.push_back(mask);
+        }
+
+        cv::RNG rng(Setup::Synthetic::Seed);
+
+        for (int width : { 63, 64, 65, 640, 641 })
+        {
+            for (double density : { 0.1, 0.5, 0.9 })
+            {
+                cv::Mat values(48, width, CV_32FC1), mask;
+                rng.fill(values, cv::RNG::UNIFORM, 0, 1);
+                cv::compare(values, density, mask, cv::CMP_LT);
+                masks.push_back(mask);
+            }
+        }
+
+        int count = masks.size();
+
+        for (int iterations = 1; iterations <= 3; ++iterations)
+        {
+            std::vector<cv::Mat> expected(count), actual(count);
+
+            double referenceMs = TimeMs(count, [&](int i)
+            {
+                cv::morphologyEx(masks[i], expected[i], cv::MORPH_CLOSE, cv::Mat(), cv::Point(-1,-1), iterations);
+            });
+
+            double kernelMs = TimeMs(count, [&](int i)
+            {
+                BinaryMask bits(masks[i]);
+                bits.Close(iterations);
+                bits.Unpack(actual[i]);
+            });
+
+            int64_t differences = 0;
+
+            for (int i = 0; i < count; ++i)
+            {
+                differences += CountDifferences(expected[i], actual[i]);
+            }
+
+            Report(fmt::format("Bit-packed close x{0}", iterations), referenceMs, kernelMs, differences);
+        }
+    }
+
+    void CheckRowBands(std::vector<spdlog::sink_ptr> sinks, const std::vector<cv::Mat>& images)
+    {
+        struct Configuration
+        {
+            std::string colorFilter;
+            bool bitPacked;
+            bool yuyv;
+            bool yuyvNative;
+        };
+
+        std::vector<Configuration> configurations;
+
+        for (std::string colorFilter : { "InRange", "Fused", "Lookup" })
+        {
+            for (bool bitPacked : { false, true })
+            {
+                configurations.push_back({ colorFilter, bitPacked, false, false });
+            }
+        }
+
+        for (bool yuyvNative : { false, true })
+        {
+            configurations.push_back({ "InRange", false, true, yuyvNative });
+        }
+
+        int count = images.size();
+
+        std::vector<Frame> bgrFrames(count), yuyvFrames(count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            bgrFrames[i].image = images[i];
+            bgrFrames[i].format = PixelFormat::BGR;
+
+            yuyvFrames[i].image = BgrToYuyv(images[i]);
+            yuyvFrames[i].format = PixelFormat::YUYV;
+        }
+
+        // Enough workers for a band on every core
+        int maxBands = std::max(2, (int)std::thread::hardware_concurrency());
+
+        Setup::Processing::PreprocessingBands = maxBands;
+
+        TargetFinder finder(sinks, "Benchmark", std::make_unique<RapidReactTargetModel>(), std::make_unique<PS3EyeModel>(), cv::Vec3d());
+
+        auto bounds = MakeBounds().front();
+
+        for (int iterations : { 1, 3 })
+        {
+            Setup::HSVFilter::MorphologyIterations = iterations;
+
+            for (auto& configuration : configurations)
+            {
+                Setup::Processing::ColorFilter = configuration.colorFilter;
+                Setup::Processing::BitPackedMorphology = configuration.bitPacked;
+                Setup::Processing::YuyvNativeProcessing = configuration.yuyvNative;
+
+                const std::vector<Frame>& frames = configuration.yuyv ? yuyvFrames : bgrFrames;
+
+                // One band processes the whole frame at once - every other band count has to match it
+                std::vector<cv::Mat> expected;
+                int64_t differences = 0;
+                std::string summary;
+                double singleMs = 0;
+
+                for (int bands = 1; bands <= maxBands; ++bands)
+                {
+                    std::vector<cv::Mat> ranged(count);
+
+                    double ms = TimeMs(count, [&](int i)
+                    {
+                        cv::Mat image, labels;
+                        finder.Preprocess(frames[i], bounds.first, bounds.second, bands, image, ranged[i], labels);
+                    });
+
+                    if (bands == 1)
+                    {
+                        expected = ranged;
+                        singleMs = ms;
+                    }
+                    else
+                    {
+                        for (int i = 0; i < count; ++i)
+                        {
+                            differences += CountDifferences(expected[i], ranged[i]);
+                        }
+                    }
+
+                    summary += fmt::format("{0}{1} {2:.3f} ms ({3:.1f}x)", bands > 1 ? ", " : "", bands, ms, singleMs / ms);
+                }
+
+                std::string name = fmt::format("Row bands, {0}{1}{2}, close x{3}",
+                    configuration.yuyv ? "YUYV " : "BGR ",
+                    configuration.yuyvNative ? "native" : configuration.colorFilter,
+                    configuration.bitPacked ? " bit-packed" : "",
+                    iterations);
+
+                logger->info("{0}: {1}, {2} pixels differ", name, summary, differences);
+
+                if (differences > 0)
+                {
+                    logger->error("{0} does not match one band", name);
+                    ++failedChecks;
+                }
+            }
+        }
+    }
+
+    void CheckDownscaledCorners(std::vector<spdlog::sink_ptr> sinks, const std::vector<cv::Mat>& frames)
+    {
+        // Corners refined after detecting on a downscaled frame should land where they do when
+        // detecting at full resolution
+        const double MaxCornerError = 1.0;
+
+        // Targets further apart than this are different targets
+        const double MatchRadius = 10;
+
+        Setup::Processing::PreprocessingBands = 1;
+        Setup::Processing::ColorFilter = "InRange";
+        Setup::Processing::BitPackedMorphology = false;
+        Setup::Processing::YuyvNativeProcessing = false;
+        Setup::Processing::TrackRegionOfInterest = false;
+        Setup::Processing::PrescanRowStep = 0;
+        Setup::HSVFilter::MorphologyIterations = 1;
+
+        TargetFinder finder(sinks, "Benchmark", std::make_unique<RapidReactTargetModel>(), std::make_unique<PS3EyeModel>(), cv::Vec3d());
+
+        for (PixelFormat format : { PixelFormat::BGR, PixelFormat::YUYV })
+        {
+            std::vector<Frame> inputs(frames.size());
+
+            for (size_t i = 0; i < frames.size(); ++i)
+            {
+                inputs[i].image = format == PixelFormat::YUYV ? BgrToYuyv(frames[i]) : frames[i];
+                inputs[i].format = format;
+            }
+
+            // Full resolution targets for every frame
+            std::vector<std::vector<Target>> expected(inputs.size());
+
+            Setup::Processing::DetectionScale = 1;
+
+            for (size_t i = 0; i < inputs.size(); ++i)
+            {
+                std::vector<VisionData> data;
+                finder.Process(inputs[i], data, expected[i]);
+            }
+
+            for (int scale : { 2, 4 })
+            {
+                Setup::Processing::DetectionScale = scale;
+
+                int corners = 0;
+                int missed = 0;
+                double errorSum = 0;
+                double errorMax = 0;
+
+                for (size_t i = 0; i < inputs.size(); ++i)
+                {
+                    std::vector<VisionData> data;
+                    std::vector<Target> targets;
+
+                    finder.Process(inputs[i], data, targets);
+
+                    for (auto& target : expected[i])
+                    {
+                        auto nearest = std::min_element(targets.begin(), targets.end(), [&](const Target& a, const Target& b)
+                        {
+                            return cv::norm(a.center - target.center) < cv::norm(b.center - target.center);
+                        });
+
+                        if (nearest == targets.end() || cv::norm(nearest->center - target.center) > MatchRadius || nearest->sections.size() != target.sections.size())
+                        {
+                            ++missed;
+                            continue;
+                        }
+
+                        for (size_t j = 0; j < target.sections.size(); ++j)
+                        {
+                            for (size_t k = 0; k < target.sections[j].corners.size(); ++k)
+                            {
+                                double error = cv::norm(nearest->sections[j].corners[k] - target.sections[j].corners[k]);
+
+                                errorSum += error;
+                                errorMax = std::max(errorMax, error);
+                                ++corners;
+                            }
+                        }
+                    }
+                }
+
+                std::string name = fmt::format("{0} corners detected at 1/{1} scale", format == PixelFormat::YUYV ? "YUYV" : "BGR", scale);
+
+                logger->info("{0}: {1} corners, mean error {2:.3f} px, max {3:.3f} px, {4} targets missed",
+                    name, corners, corners > 0 ? errorSum / corners : 0.0, errorMax, missed);
+
+                if (corners == 0 || errorMax > MaxCornerError)
+                {
+                    logger->error("{0} are not within {1} px of full resolution", name, MaxCornerError);
+                    ++failedChecks;
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<spdlog::sink_ptr> sinks { std::make_shared<spdlog::sinks::ansicolor_stdout_sink_mt>() };
+
+    Setup::Diagnostics::LogLevel = spdlog::level::info;
+
+    logger = std::make_shared<spdlog::logger>("Benchmark", sinks.begin(), sinks.end());
+    logger->set_level(Setup::Diagnostics::LogLevel);
+
+    int frameCount = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20;
+
+    std::vector<cv::Mat> frames = RenderFrames(sinks, frameCount);
+
+    if (frames.empty())
+    {
+        logger->error("No synthetic frames rendered");
+        return 1;
+    }
+
+    // Kernels are checked on every color as well as on the rendered frames
+    std::vector<cv::Mat> images = frames;
+    std::vector<cv::Mat> noise = MakeNoise(frames.front().size());
+
+    images.insert(images.end(), noise.begin(), noise.end());
+
+    CheckFusedThreshold(images);
+    CheckLookupTable(images);
+    CheckBitPackedMorphology(images);
+    CheckRowBands(sinks, images);
+    CheckDownscaledCorners(sinks, frames);
+
+    if (failedChecks > 0)
+    {
+        logger->error("{0} checks failed", failedChecks);
+    }
+    else
+    {
+        logger->info("All checks passed");
+    }
+
+    return failedChecks;
+}
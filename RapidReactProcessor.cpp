@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <thread>
 
 #include "RapidReactProcessor.h"
@@ -7,60 +8,182 @@
 
 using namespace Lightning;
 
-RapidReactProcessor::RapidReactProcessor(std::vector<spdlog::sink_ptr> sinks, std::string name, std::shared_ptr<cv::VideoCapture> capture, cv::Vec3d offset)
-    : _capture(capture)
-    , _targetFinder(std::make_unique<TargetFinder>(sinks, name, std::make_unique<RapidReactTargetModel>(), std::make_unique<PS3EyeModel>(), offset))
+RapidReactProcessor::RapidReactProcessor(std::vector<spdlog::sink_ptr> sinks, std::string name, std::shared_ptr<FrameSource> source, cv::Vec3d offset)
+    : _targetFinder(std::make_unique<TargetFinder>(sinks, name, std::make_unique<RapidReactTargetModel>(), std::make_unique<PS3EyeModel>(), offset))
+    , _source(source)
     , _name(name)
+    , _hasLastFrame(false)
+    , _lastSequence(0)
+    , _lastFingerprint(0)
+    , _reusedCount(0)
+    , _processedCount(0)
+    , _rateStart(std::chrono::steady_clock::now())
 {
     _logger = std::make_shared<spdlog::logger>(name, sinks.begin(), sinks.end());
     _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
 
-    if (Setup::Diagnostics::RecordVideo)
-    {
-        std::string path = fmt::format("{0}{1}_raw.avi", Setup::Diagnostics::RecordVideoPath, _name);
+    _captureThread = std::make_unique<CaptureThread>(sinks, name, source);
 
-        _rawVideoWriter = std::make_unique<cv::VideoWriter>();
+    if (Setup::Diagnostics::RecordVideo && Setup::Diagnostics::RecordRawFrames)
+    {
+        // Raw frames are recorded by the capture thread so frames dropped before processing are kept too
+        std::string path = fmt::format("{0}{1}_raw.frames", Setup::Diagnostics::RecordVideoPath, _name);
 
-        _rawVideoWriter->open(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 20, 
-            cv::Size(Setup::Camera::Width, Setup::Camera::Height),
-            true);
+        _captureThread->SetRecorder(std::make_unique<FrameRecorder>(sinks, path));
+    }
+    else if (Setup::Diagnostics::RecordVideo)
+    {
+        // Opened on the first frame - a camera that is still reconnecting has no mode yet
+        _rawVideoPath = fmt::format("{0}{1}_raw.avi", Setup::Diagnostics::RecordVideoPath, _name);
     }
+
+    _captureThread->Start();
 }
 
-bool RapidReactProcessor::ProcessNextImage(std::vector<VisionData>& targetData)
+bool RapidReactProcessor::ProcessNextImage(VisionMessage& message)
 {
-    if (_capture->isOpened())
+    // Wait for the newest frame from the capture thread
+    std::unique_ptr<Frame> frame = _captureThread->WaitForFrame(std::chrono::milliseconds(100));
+
+    if (!frame)
     {
-        // Read next frame from source
-        cv::Mat image;
-        _capture->read(image);
+        if (!_captureThread->IsRunning())
+        {
+            _logger->trace("Capture is not running");
+            return false;
+        }
 
-        if (Setup::Diagnostics::RecordVideo && _rawVideoWriter)
+        // Report the camera as down while the capture thread reconnects
+        if (!_captureThread->IsConnected())
         {
-            _rawVideoWriter->write(image);
-            
+            message.status = VisionStatus::CameraError;
+            message.capture = _captureStatistics;
+            return true;
         }
 
-        if (!image.empty())
+        return false;
+    }
+
+    // Settings stay put while this frame is processed
+    std::shared_lock<SettingsMutex> setupLock(Setup::GetMutex());
+
+    // Driver frames are too bright to find targets in - they only go to the driver stream
+    if (frame->exposure == ExposureClass::DriverExposure)
+    {
+        if (_driverStream)
         {
-            _targetFinder->Process(image, targetData);
+            _driverStream->Send(_name, *frame);
+        }
+
+        return false;
+    }
+
+    if (Setup::Diagnostics::RecordVideo && !_rawVideoPath.empty())
+    {
+        cv::Mat image;
 
-            if (Setup::Diagnostics::RecordProcessedVideo && _processedVideoWriter)
+        if (frame->ConvertToBgr(image))
+        {
+            if (!_rawVideoWriter)
             {
-                
+                // Record at the mode the source actually delivers
+                double frameRate = _source->GetFrameRate() > 0 ? _source->GetFrameRate() : 20;
+
+                _rawVideoWriter = std::make_unique<cv::VideoWriter>();
+                _rawVideoWriter->open(_rawVideoPath, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), frameRate, image.size(), true);
             }
 
-            return true;
+            _rawVideoWriter->write(image);
         }
-        else
+    }
+
+    message.captureTime = frame->GetTimestampMicroseconds();
+    message.sequence = frame->sequence;
+
+    if (Setup::Processing::SkipUnchangedFrames && IsUnchanged(*frame))
+    {
+        // Same pixels as last time - republish the previous result rather than recomputing it
+        message.packets = _lastPackets;
+
+        for (auto& packet : message.packets)
         {
-            _logger->error("Invalid image - shutting down capture");
-            _capture->release();
-            return false;
+            packet.reused = true;
+            packet.captureTime = message.captureTime;
+            packet.sequence = message.sequence;
         }
+
+        ++_reusedCount;
+    }
+    else
+    {
+        _targetFinder->Process(*frame, message.packets);
+
+        _lastPackets = message.packets;
+    }
+
+    bool targetFound = std::any_of(message.packets.begin(), message.packets.end(), [](const VisionData& data){ return data.status == VisionStatus::TargetFound; });
+
+    message.status = targetFound ? VisionStatus::TargetFound : VisionStatus::NoTargetFound;
+
+    // Releasing the frame hands its buffer back to the source
+    frame.reset();
+
+    ++_processedCount;
+
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - _rateStart).count();
+
+    if (elapsed >= 5.0)
+    {
+        _captureStatistics = _captureThread->CollectStatistics();
+
+        // Sequence gaps are lost before capture, slow reads in the capture loop and drops in processing
+        _logger->debug("Captured {0:.1f} fps, interval mean {1:.2f} p99 {2:.2f} max {3:.2f} ms, {4} sequence gaps, read latency mean {5:.2f} max {6:.2f} ms",
+            _captureStatistics.frames / elapsed, _captureStatistics.meanInterval, _captureStatistics.p99Interval, _captureStatistics.maxInterval,
+            _captureStatistics.sequenceGaps, _captureStatistics.meanReadLatency, _captureStatistics.maxReadLatency);
+
+        _logger->debug("Processed {0:.1f} fps, {1} frames dropped, {2} unchanged frames reused", _processedCount / elapsed, _captureStatistics.processingDrops, _reusedCount);
+
+        _processedCount = 0;
+        _reusedCount = 0;
+        _rateStart = now;
     }
 
-    return false;
+    message.capture = _captureStatistics;
+
+    if (Setup::Diagnostics::RecordProcessedVideo && _processedVideoWriter)
+    {
+        
+    }
+
+    return true;
+}
+
+bool RapidReactProcessor::IsUnchanged(const Frame& frame)
+{
+    bool unchanged;
+
+    if (frame.deviceSequence)
+    {
+        // Every capture gets a new sequence number, so only a buffer re-delivered by the driver
+        // keeps the same one - and its timestamp, which also covers the count restarting on reconnect
+        unchanged = _hasLastFrame && frame.sequence == _lastSequence && frame.timestamp == _lastTimestamp;
+    }
+    else
+    {
+        // Sources without one can deliver the same image again under a new number, so compare pixels
+        uint64_t fingerprint = frame.GetFingerprint();
+
+        unchanged = _hasLastFrame && fingerprint == _lastFingerprint;
+
+        _lastFingerprint = fingerprint;
+    }
+
+    _hasLastFrame = true;
+    _lastSequence = frame.sequence;
+    _lastTimestamp = frame.timestamp;
+
+    return unchanged;
 }
 
 void RapidReactProcessor::ShowDebugImages()
@@ -6,11 +6,9 @@
 
 #include "VisionData.hpp"
 #include "TargetFinder.h"
-
-namespace cv
-{
-class VideoCapture;
-}
+#include "CaptureThread.h"
+#include "FrameSource.h"
+#include "DriverStreamSender.h"
 
 namespace Lightning
 {
@@ -18,20 +16,46 @@ namespace Lightning
 class RapidReactProcessor
 {
 public:
-    RapidReactProcessor(std::vector<spdlog::sink_ptr>, std::string, std::shared_ptr<cv::VideoCapture>, cv::Vec3d);
+    RapidReactProcessor(std::vector<spdlog::sink_ptr>, std::string, std::shared_ptr<FrameSource>, cv::Vec3d);
 
-    bool ProcessNextImage(std::vector<VisionData>&);
+    bool ProcessNextImage(VisionMessage&);
+
+    // Stream that driver-exposure frames are published on - they are dropped without one
+    void SetDriverStream(std::shared_ptr<DriverStreamSender> driverStream) { _driverStream = driverStream; }
 
     void ShowDebugImages();
 
+    // False while the capture thread is reconnecting or after its source has finished
+    bool IsCameraConnected() const { return _captureThread->IsConnected(); }
+
 private:
     std::shared_ptr<spdlog::logger> _logger;
 
-    std::shared_ptr<cv::VideoCapture> _capture;
+    std::unique_ptr<CaptureThread> _captureThread;
     std::unique_ptr<TargetFinder> _targetFinder;
+    std::shared_ptr<DriverStreamSender> _driverStream;
+    std::shared_ptr<FrameSource> _source;
 
     std::string _name;
 
+    // Identity of the last processed frame and its results, for republishing unchanged frames
+    bool _hasLastFrame;
+    uint64_t _lastSequence;
+    std::chrono::steady_clock::time_point _lastTimestamp;
+    uint64_t _lastFingerprint;
+    std::vector<VisionData> _lastPackets;
+    int _reusedCount;
+
+    bool IsUnchanged(const Frame&);
+
+    // Processing rate, logged periodically
+    int _processedCount;
+    std::chrono::steady_clock::time_point _rateStart;
+
+    // Capture timing for the last reporting window, sent with every message
+    CaptureStatistics _captureStatistics;
+
+    std::string _rawVideoPath;
     std::unique_ptr<cv::VideoWriter> _rawVideoWriter;
     std::unique_ptr<cv::VideoWriter> _processedVideoWriter;
 };
@@ -1,60 +1,110 @@
+#include <sstream>
+#include <stdexcept>
+
 #include <opencv2/opencv.hpp>
 
 #include "RapidReactVision.h"
 #include "Setup.h"
 #include "VisionData.hpp"
 #include "DataSender.h"
+#include "FileFrameSource.h"
+#include "ImageDirectoryFrameSource.h"
+#include "MjpegFrameSource.h"
+#include "RecordingFrameSource.h"
+#include "SyntheticFrameSource.h"
+#include "RapidReactTargetModel.h"
+#include "PS3Eye.h"
+#include "V4L2FrameSource.h"
+
+#ifdef USE_GSTREAMER
+#include "GStreamerFrameSource.h"
+#endif
 
 using namespace Lightning;
 
 RapidReactVision::RapidReactVision(std::vector<spdlog::sink_ptr> sinks)
-    : _isProcessorRunning(false)
-    , _doProcessing(false)
+    : _doProcessing(false)
+    , _isProcessorRunning(false)
 {
     _logger = std::make_shared<spdlog::logger>("RapidReactVision", sinks.begin(), sinks.end());
     _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
 
-    // Setup capture
+    // Setup cameras
+    std::vector<int> cameraIds;
+
     if (Setup::Camera::CameraId >= 0)
-    {    
-        if (Setup::Diagnostics::UseTestVideo)
-        {
-            _targetCapture = std::make_shared<cv::VideoCapture>(Setup::Diagnostics::TestVideoPath);
-            _logger->info("Capture set to video: {0}", Setup::Diagnostics::TestVideoPath);
-        }
-        else if (Setup::Diagnostics::UseTestImage)
-        {
-            _targetCapture = std::make_shared<cv::VideoCapture>(Setup::Diagnostics::TestImagePath);
-            _logger->info("Capture set to image(s): {0}", Setup::Diagnostics::TestImagePath);
-        }
-        else
+    {
+        cameraIds.push_back(Setup::Camera::CameraId);
+
+        // Test sources stand in for a single camera
+        if (!Setup::Diagnostics::UseSyntheticImages && !Setup::Diagnostics::UseTestVideo && !Setup::Diagnostics::UseTestRecording && !Setup::Diagnostics::UseTestImage)
         {
-            _targetCapture = std::make_shared<cv::VideoCapture>(Setup::Camera::CameraId);
-            _logger->info("Capture set to camera ID: {0}", Setup::Camera::CameraId);
+            std::stringstream ids(Setup::Camera::AdditionalCameraIds);
+            std::string id;
+
+            while (std::getline(ids, id, ','))
+            {
+                if (id.empty())
+                {
+                    continue;
+                }
+
+                // A typo in the file shouldn't stop the cameras that are set up correctly
+                try
+                {
+                    cameraIds.push_back(std::stoi(id));
+                }
+                catch (const std::exception&)
+                {
+                    _logger->error("Ignoring invalid camera ID in AdditionalCameraIds: '{0}'", id);
+                }
+            }
         }
-        
     }
     else
     {
         _logger->info("Capture will not be used");
     }
 
-    // Setup processor
-    if (_targetCapture)
+    // Driver frames are only captured when exposures alternate
+    if (Setup::Camera::TargetFramesPerDriverFrame > 0)
+    {
+        _driverStream = std::make_shared<DriverStreamSender>(sinks);
+    }
+
+    for (int cameraId : cameraIds)
     {
-        if (_targetCapture->isOpened())
+        auto camera = std::make_unique<Camera>();
+        camera->id = cameraId;
+        camera->frameSource = CreateFrameSource(sinks, cameraId);
+
+        // Setup processor - a camera that fails to open is retried by its capture thread
+        bool opened = camera->frameSource->Open();
+
+        if (!opened && camera->frameSource->CanReconnect())
+        {
+            _logger->error("Failed to open capture for camera ID: {0} - will keep retrying", cameraId);
+        }
+
+        if (opened || camera->frameSource->CanReconnect())
         {
             // TODO remove this
             cv::Vec3d offset(Setup::Processing::XOffset, Setup::Processing::YOffset, Setup::Processing::ZOffset);
 
-            _targetProcessor = std::make_unique<RapidReactProcessor>(sinks, "Main", _targetCapture, offset);  
+            std::string name = cameraIds.size() == 1 ? "Main" : fmt::format("Camera{0}", cameraId);
+
+            camera->processor = std::make_unique<RapidReactProcessor>(sinks, name, camera->frameSource, offset);  
+            camera->processor->SetDriverStream(_driverStream);
         }
         else
         {           
-            _logger->error("Failed to open capture.");          
+            _logger->error("Failed to open capture for camera ID: {0}", cameraId);          
         }
+
+        _cameras.push_back(std::move(camera));
     }
-    else
+
+    if (_cameras.empty())
     {
         _logger->info("Processor will not be used");
     }  
@@ -62,6 +112,65 @@ RapidReactVision::RapidReactVision(std::vector<spdlog::sink_ptr> sinks)
     _dataSender = std::make_unique<DataSender>();
 }
 
+std::shared_ptr<FrameSource> RapidReactVision::CreateFrameSource(std::vector<spdlog::sink_ptr> sinks, int cameraId)
+{
+    std::shared_ptr<FrameSource> source;
+
+    if (Setup::Diagnostics::UseSyntheticImages)
+    {
+        _logger->info("Capture set to synthetic images");
+        return std::make_shared<SyntheticFrameSource>(sinks, std::make_unique<RapidReactTargetModel>(), std::make_unique<PS3EyeModel>());
+    }
+    else if (Setup::Diagnostics::UseTestVideo)
+    {
+        _logger->info("Capture set to video: {0}", Setup::Diagnostics::TestVideoPath);
+        return std::make_shared<FileFrameSource>(sinks, Setup::Diagnostics::TestVideoPath);
+    }
+    else if (Setup::Diagnostics::UseTestRecording)
+    {
+        _logger->info("Capture set to recording: {0}", Setup::Diagnostics::TestRecordingPath);
+        source = std::make_shared<RecordingFrameSource>(sinks, Setup::Diagnostics::TestRecordingPath, Setup::Diagnostics::ReplayRealTime);
+    }
+    else if (Setup::Diagnostics::UseTestImage)
+    {
+        _logger->info("Capture set to image(s): {0}", Setup::Diagnostics::TestImagePath);
+
+        // printf-style sequences (e.g. img_%03d.png) are left to OpenCV
+        if (Setup::Diagnostics::TestImagePath.find('%') != std::string::npos)
+        {
+            return std::make_shared<FileFrameSource>(sinks, Setup::Diagnostics::TestImagePath);
+        }
+
+        return std::make_shared<ImageDirectoryFrameSource>(sinks, Setup::Diagnostics::TestImagePath, Setup::Diagnostics::ImageDecodeThreads, Setup::Diagnostics::ImagePrefetchDepth);
+    }
+    else if (Setup::Camera::UseGStreamer)
+    {
+#ifdef USE_GSTREAMER
+        std::string pipeline = Setup::Camera::GStreamerPipeline;
+        size_t position = pipeline.find("{id}");
+
+        if (position != std::string::npos)
+        {
+            pipeline.replace(position, 4, std::to_string(cameraId));
+        }
+
+        _logger->info("Capture set to GStreamer pipeline: {0}", pipeline);
+        source = std::make_shared<GStreamerFrameSource>(sinks, pipeline);
+#else
+        _logger->error("GStreamer capture requested but not built - rebuild with USE_GSTREAMER, using V4L2 camera ID: {0}", cameraId);
+        source = std::make_shared<V4L2FrameSource>(sinks, cameraId);
+#endif
+    }
+    else
+    {
+        _logger->info("Capture set to camera ID: {0}", cameraId);
+        source = std::make_shared<V4L2FrameSource>(sinks, cameraId);
+    }
+
+    // MJPEG frames are decoded at the scale we process at - other formats pass straight through
+    return std::make_shared<MjpegFrameSource>(sinks, source, Setup::Camera::JpegScale);
+}
+
 bool RapidReactVision::StartProcessing()
 {
     if (_isProcessorRunning)
@@ -89,10 +198,44 @@ void RapidReactVision::StopProcessing()
     _doProcessing = false;
 }
 
+void RapidReactVision::ProcessCamera(Camera& camera)
+{
+    _logger->debug("Enter camera {0} thread", camera.id);
+
+    while (_doProcessing)
+    {
+        VisionMessage message { camera.id };
+
+        if (!camera.processor->ProcessNextImage(message))
+        {
+            continue;
+        }
+
+        // Replace any result the publisher has not sent yet
+        {
+            std::lock_guard<std::mutex> lock(_pendingMutex);
+            _pendingMessages[camera.id] = message;
+        }
+
+        _pendingCondition.notify_one();
+    }
+
+    _logger->debug("Leaving camera {0} thread", camera.id);
+}
+
 void RapidReactVision::Process()
 {
     _logger->debug("Enter Process thread");
 
+    // Run each camera on its own thread so they don't slow each other down
+    for (auto& camera : _cameras)
+    {
+        if (camera->processor)
+        {
+            camera->thread = std::thread(&RapidReactVision::ProcessCamera, this, std::ref(*camera));
+        }
+    }
+
     while (_doProcessing)
     {
         if (Setup::Diagnostics::ReadSetupFile)
@@ -100,21 +243,34 @@ void RapidReactVision::Process()
             Setup::LoadSetup();
         }
 
-        std::vector<VisionData> targetData;
+        // Wait for any camera to produce a result
+        std::vector<VisionMessage> messages;
 
-        if (_targetProcessor)
         {
-            _targetProcessor->ProcessNextImage(targetData);
-            // TODO check return? - shutdown after so any failed attempts?
+            std::unique_lock<std::mutex> lock(_pendingMutex);
+            _pendingCondition.wait_for(lock, std::chrono::milliseconds(100), [this]{ return !_pendingMessages.empty(); });
+
+            for (auto& pending : _pendingMessages)
+            {
+                messages.push_back(pending.second);
+            }
+
+            _pendingMessages.clear();
         }
 
         // Apply robot-specific offsets
 
-        // Pack results
-        std::vector<VisionMessage> messages
+        // Nothing new from any camera - still publish so the robot knows we're alive
+        if (messages.empty())
         {
-            VisionMessage { Setup::Camera::CameraId, targetData }
-        };
+            for (auto& camera : _cameras)
+            {
+                VisionMessage message { camera->id };
+                message.status = camera->processor && camera->processor->IsCameraConnected() ? VisionStatus::NoTargetFound : VisionStatus::CameraError;
+
+                messages.push_back(message);
+            }
+        }
 
         // Send results
         _dataSender->Send(messages);
@@ -122,9 +278,12 @@ void RapidReactVision::Process()
         // Display diagnostic images, if desired
         if (Setup::Diagnostics::DisplayDebugImages)
         {
-            if (_targetProcessor)
+            for (auto& camera : _cameras)
             {
-                _targetProcessor->ShowDebugImages();
+                if (camera->processor)
+                {
+                    camera->processor->ShowDebugImages();
+                }
             }
 
             int key = cv::waitKey(Setup::Diagnostics::WaitKeyDelay);
@@ -137,7 +296,15 @@ void RapidReactVision::Process()
         }
     }
 
+    for (auto& camera : _cameras)
+    {
+        if (camera->thread.joinable())
+        {
+            camera->thread.join();
+        }
+    }
+
     _isProcessorRunning = false;
 
     _logger->debug("Leaving Process thread");
-}
\ No newline at end of file
+}
@@ -1,14 +1,13 @@
 #pragma once
 
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
 #include "RapidReactProcessor.h"
 #include "DataSender.h"
-
-namespace cv
-{
-
-class VideoCapture;
-
-}
+#include "DriverStreamSender.h"
+#include "FrameSource.h"
 
 namespace Lightning
 {
@@ -26,19 +25,37 @@ public:
 
 private:
 
+    // Each camera has its own capture and processor, run on its own thread
+    struct Camera
+    {
+        int id;
+        std::shared_ptr<FrameSource> frameSource;
+        std::unique_ptr<RapidReactProcessor> processor;
+        std::thread thread;
+    };
+
     void Process();
 
-    std::unique_ptr<RapidReactProcessor> _targetProcessor;
+    void ProcessCamera(Camera&);
+
+    std::shared_ptr<FrameSource> CreateFrameSource(std::vector<spdlog::sink_ptr>, int);
 
-    std::shared_ptr<cv::VideoCapture> _targetCapture;
+    std::vector<std::unique_ptr<Camera>> _cameras;
 
     std::unique_ptr<DataSender> _dataSender;
 
+    std::shared_ptr<DriverStreamSender> _driverStream;
+
     std::shared_ptr<spdlog::logger> _logger;
 
+    // Newest unsent result from each camera, merged into one publish by Process()
+    std::map<int, VisionMessage> _pendingMessages;
+    std::mutex _pendingMutex;
+    std::condition_variable _pendingCondition;
+
     std::atomic<bool> _doProcessing;
     std::atomic<bool> _isProcessorRunning;
 
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Lightning
+{
+
+namespace Recording
+{
+    // Layout of a raw frame recording:
+    //   FileHeader
+    //   FrameHeader + frame data (padded to 8 bytes), repeated for each frame
+    //   IndexEntry for each frame - only present if the recording was closed cleanly
+    // The frame headers allow the index to be rebuilt if the recording was cut off.
+
+    const char Magic[8] = { 'L', 'T', 'N', 'G', 'R', 'A', 'W', '1' };
+
+    const uint32_t Version = 1;
+
+    // "FRAM"
+    const uint32_t FrameMagic = 0x4d415246;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t format;        // PixelFormat of every frame
+        uint32_t width;
+        uint32_t height;
+        uint64_t frameCount;    // 0 until the recording is closed
+        uint64_t indexOffset;   // 0 until the recording is closed
+        uint8_t reserved[24];
+    };
+
+    struct FrameHeader
+    {
+        uint32_t magic;
+        uint32_t size;          // Frame data size in bytes, without padding
+        int64_t timestamp;      // Capture time in microseconds on the steady clock
+        uint64_t sequence;
+    };
+
+    struct IndexEntry
+    {
+        uint64_t offset;        // Offset of the frame data
+        int64_t timestamp;
+        uint64_t sequence;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(FileHeader) == 64, "FileHeader must be 64 bytes");
+    static_assert(sizeof(FrameHeader) == 24, "FrameHeader must be 24 bytes");
+    static_assert(sizeof(IndexEntry) == 32, "IndexEntry must be 32 bytes");
+
+    inline uint64_t PaddedSize(uint64_t size) { return (size + 7) & ~(uint64_t)7; }
+}
+
+}
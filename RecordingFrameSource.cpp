@@ -0,0 +1,259 @@
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RecordingFrameSource.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+struct RecordingFrameSource::Mapping
+{
+    uint8_t* data = nullptr;
+    size_t size = 0;
+
+    ~Mapping()
+    {
+        if (data)
+        {
+            munmap(data, size);
+        }
+    }
+};
+
+RecordingFrameSource::RecordingFrameSource(std::vector<spdlog::sink_ptr> sinks, std::string path, bool realTime)
+    : _nextFrame(0)
+    , _path(path)
+    , _realTime(realTime)
+    , _format(PixelFormat::BGR)
+    , _frameRate(0)
+{
+    _logger = std::make_shared<spdlog::logger>("RecordingFrameSource", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+}
+
+RecordingFrameSource::~RecordingFrameSource()
+{
+    Release();
+}
+
+bool RecordingFrameSource::Open()
+{
+    Release();
+
+    int fd = open(_path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        _logger->error("Failed to open {0}: {1}", _path, std::strerror(errno));
+        return false;
+    }
+
+    struct stat status;
+
+    if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(Recording::FileHeader))
+    {
+        _logger->error("{0} is not a recording", _path);
+        close(fd);
+        return false;
+    }
+
+    // Private mapping so frames can be written to without touching the file
+    void* data = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        _logger->error("mmap failed: {0}", std::strerror(errno));
+        return false;
+    }
+
+    _mapping = std::make_shared<Mapping>();
+    _mapping->data = static_cast<uint8_t*>(data);
+    _mapping->size = status.st_size;
+
+    madvise(data, status.st_size, MADV_SEQUENTIAL);
+
+    if (!BuildIndex())
+    {
+        _mapping.reset();
+        return false;
+    }
+
+    if (_index.size() > 1)
+    {
+        double duration = (_index.back().timestamp - _index.front().timestamp) / 1e6;
+        _frameRate = duration > 0 ? (_index.size() - 1) / duration : 0;
+    }
+
+    _nextFrame = 0;
+
+    _logger->info("Opened {0}: {1} frames {2}x{3}@{4:.1f} ({5})", _path, _index.size(), _size.width, _size.height, _frameRate, _realTime ? "real time" : "as fast as possible");
+
+    return true;
+}
+
+bool RecordingFrameSource::BuildIndex()
+{
+    const Recording::FileHeader* header = reinterpret_cast<const Recording::FileHeader*>(_mapping->data);
+
+    if (std::memcmp(header->magic, Recording::Magic, sizeof(header->magic)) != 0 || header->version != Recording::Version)
+    {
+        _logger->error("{0} is not a version {1} recording", _path, Recording::Version);
+        return false;
+    }
+
+    _format = (PixelFormat)header->format;
+    _size = cv::Size(header->width, header->height);
+
+    _index.clear();
+
+    // Use the index if the recording was closed cleanly
+    if (header->indexOffset > 0 && header->indexOffset <= _mapping->size &&
+        header->frameCount <= (_mapping->size - header->indexOffset) / sizeof(Recording::IndexEntry))
+    {
+        const Recording::IndexEntry* index = reinterpret_cast<const Recording::IndexEntry*>(_mapping->data + header->indexOffset);
+
+        for (uint64_t i = 0; i < header->frameCount; ++i)
+        {
+            if (IsValidEntry(index[i]))
+            {
+                _index.push_back(index[i]);
+            }
+        }
+
+        if (_index.size() < header->frameCount)
+        {
+            _logger->warn("{0}: dropped {1} of {2} index entries that don't fit the file", _path, header->frameCount - _index.size(), header->frameCount);
+        }
+
+        return true;
+    }
+
+    // Otherwise walk the frame headers to rebuild it
+    _logger->warn("{0} has no index - scanning frames", _path);
+
+    uint64_t offset = sizeof(Recording::FileHeader);
+
+    while (offset + sizeof(Recording::FrameHeader) <= _mapping->size)
+    {
+        const Recording::FrameHeader* frameHeader = reinterpret_cast<const Recording::FrameHeader*>(_mapping->data + offset);
+
+        uint64_t dataOffset = offset + sizeof(Recording::FrameHeader);
+
+        if (frameHeader->magic != Recording::FrameMagic || dataOffset + frameHeader->size > _mapping->size)
+        {
+            // Truncated frame at the end of an interrupted recording
+            break;
+        }
+
+        Recording::IndexEntry entry { dataOffset, frameHeader->timestamp, frameHeader->sequence, frameHeader->size };
+
+        if (IsValidEntry(entry))
+        {
+            _index.push_back(entry);
+        }
+        else
+        {
+            _logger->warn("{0}: skipping frame {1} with {2} bytes of data", _path, frameHeader->sequence, frameHeader->size);
+        }
+
+        offset = dataOffset + Recording::PaddedSize(frameHeader->size);
+    }
+
+    return true;
+}
+
+bool RecordingFrameSource::IsValidEntry(const Recording::IndexEntry& entry) const
+{
+    // Frame data has to be inside the file
+    if (entry.offset < sizeof(Recording::FileHeader) || entry.offset > _mapping->size || entry.size > _mapping->size - entry.offset)
+    {
+        return false;
+    }
+
+    // Uncompressed frames have to be exactly one image
+    size_t pixels = (size_t)_size.width * _size.height;
+
+    switch (_format)
+    {
+        case PixelFormat::MJPG:
+            return entry.size > 0;
+        case PixelFormat::YUYV:
+            return pixels > 0 && entry.size == 2 * pixels;
+        case PixelFormat::GREY:
+            return pixels > 0 && entry.size == pixels;
+        default:
+            return pixels > 0 && entry.size == 3 * pixels;
+    }
+}
+
+bool RecordingFrameSource::IsOpened() const
+{
+    return (bool)_mapping;
+}
+
+bool RecordingFrameSource::Read(Frame& frame)
+{
+    if (!IsOpened() || _nextFrame >= _index.size())
+    {
+        return false;
+    }
+
+    const Recording::IndexEntry& entry = _index[_nextFrame];
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (_nextFrame == 0)
+    {
+        _replayStart = now;
+    }
+
+    std::chrono::microseconds recordedTime(entry.timestamp - _index.front().timestamp);
+
+    // Hold the frame back until it is due
+    if (_realTime)
+    {
+        std::this_thread::sleep_until(_replayStart + recordedTime);
+    }
+
+    void* data = _mapping->data + entry.offset;
+
+    switch (_format)
+    {
+        case PixelFormat::MJPG:
+            frame.image = cv::Mat(1, (int)entry.size, CV_8UC1, data);
+            break;
+        case PixelFormat::YUYV:
+            frame.image = cv::Mat(_size, CV_8UC2, data);
+            break;
+        case PixelFormat::GREY:
+            frame.image = cv::Mat(_size, CV_8UC1, data);
+            break;
+        default:
+            frame.image = cv::Mat(_size, CV_8UC3, data);
+            break;
+    }
+
+    frame.format = _format;
+    frame.sequence = entry.sequence;
+    frame.timestamp = _realTime ? _replayStart + recordedTime : now;
+
+    // Keep the mapping alive while the frame is in use
+    frame.buffer = std::shared_ptr<void>(_mapping, data);
+
+    ++_nextFrame;
+
+    return true;
+}
+
+void RecordingFrameSource::Release()
+{
+    _mapping.reset();
+    _index.clear();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include "spdlog/spdlog.h"
+
+#include "FrameSource.h"
+#include "RecordingFormat.hpp"
+
+namespace Lightning
+{
+
+// Replays a raw frame recording straight out of a memory mapping, either with the
+// original frame timing or as fast as the pipeline will take frames
+class RecordingFrameSource : public FrameSource
+{
+public:
+
+    RecordingFrameSource(std::vector<spdlog::sink_ptr>, std::string, bool realTime);
+    ~RecordingFrameSource();
+
+    virtual bool Open();
+
+    virtual bool IsOpened() const;
+
+    virtual bool Read(Frame&);
+
+    virtual void Release();
+
+    // Real time replay drops frames the same way a camera would
+    virtual bool IsLive() const { return _realTime; }
+
+    virtual bool CanReconnect() const { return false; }
+
+    virtual cv::Size GetFrameSize() const { return _size; }
+
+    virtual double GetFrameRate() const { return _frameRate; }
+
+private:
+
+    // Mapping shared with outstanding frames
+    struct Mapping;
+
+    bool BuildIndex();
+
+    // True if the entry's data lies inside the file and is the right size for the format
+    bool IsValidEntry(const Recording::IndexEntry&) const;
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::shared_ptr<Mapping> _mapping;
+
+    std::vector<Recording::IndexEntry> _index;
+    size_t _nextFrame;
+
+    std::string _path;
+    bool _realTime;
+
+    PixelFormat _format;
+    cv::Size _size;
+    double _frameRate;
+
+    // Replay clock - recorded timestamps are shifted to start when replay starts
+    std::chrono::steady_clock::time_point _replayStart;
+};
+
+}
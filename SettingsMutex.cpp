@@ -0,0 +1,55 @@
+#include "SettingsMutex.h"
+
+using namespace Lightning;
+
+SettingsMutex::SettingsMutex()
+    : _readers(0)
+    , _waitingWriters(0)
+    , _writing(false)
+{
+}
+
+void SettingsMutex::lock()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    ++_waitingWriters;
+    _condition.wait(lock, [this]{ return !_writing && _readers == 0; });
+    --_waitingWriters;
+
+    _writing = true;
+}
+
+void SettingsMutex::unlock()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _writing = false;
+    }
+
+    _condition.notify_all();
+}
+
+void SettingsMutex::lock_shared()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _condition.wait(lock, [this]{ return !_writing && _waitingWriters == 0; });
+
+    ++_readers;
+}
+
+void SettingsMutex::unlock_shared()
+{
+    bool last;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        last = --_readers == 0;
+    }
+
+    if (last)
+    {
+        _condition.notify_all();
+    }
+}
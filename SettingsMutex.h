@@ -0,0 +1,33 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+namespace Lightning
+{
+
+// Shared mutex that lets a waiting writer in ahead of new readers, so threads that hold it
+// shared for most of every frame can't keep a writer out. Not recursive.
+class SettingsMutex
+{
+public:
+
+    SettingsMutex();
+
+    void lock();
+    void unlock();
+
+    void lock_shared();
+    void unlock_shared();
+
+private:
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+
+    int _readers;
+    int _waitingWriters;
+    bool _writing;
+};
+
+}
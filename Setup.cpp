@@ -1,3 +1,5 @@
+#include <sys/stat.h>
+
 #include <simpleini/SimpleIni.h>
 #include "spdlog/spdlog.h"
 
@@ -10,8 +12,25 @@ namespace Setup
     namespace Camera
     {
         int CameraId = 0;
+        std::string AdditionalCameraIds = "";
         int Width = 640;
         int Height = 480;
+        int Fps = 60;
+        std::string PixelFormat = "YUYV";
+        int JpegScale = 1;
+        bool AutoExposure = false;
+        int Exposure = 5;
+        bool AutoGain = false;
+        int Gain = 0;
+        bool AutoWhiteBalance = false;
+        int Contrast = 50;
+        bool HorizontalFlip = true;
+        bool VerticalFlip = true;
+        int DriverExposure = 150;
+        int TargetFramesPerDriverFrame = 0;
+        int ExposureLatencyFrames = 2;
+        bool UseGStreamer = false;
+        std::string GStreamerPipeline = "v4l2src device=/dev/video{id} ! image/jpeg,width=640,height=480,framerate=60/1 ! jpegdec ! videoconvert ! video/x-raw,format=BGR ! appsink name=sink";
     }
 
     namespace Network
@@ -19,19 +38,35 @@ namespace Setup
         int DataPort = 5801;
     }
 
+    namespace DriverStream
+    {
+        int Port = 5802;
+        double Scale = 0.5;
+        int JpegQuality = 50;
+    }
+
     namespace Diagnostics
     {
+        bool UseSyntheticImages = false;
         bool UseTestImage = false;
         std::string TestImagePath = "";
+        int ImageDecodeThreads = 3;
+        int ImagePrefetchDepth = 8;
         bool UseTestVideo = false;
         std::string TestVideoPath = "";
+        bool UseTestRecording = false;
+        std::string TestRecordingPath = "";
+        bool ReplayRealTime = true;
         spdlog::level::level_enum LogLevel = spdlog::level::debug;
         bool DisplayDebugImages = false;
         bool RecordVideo = false;
+        bool RecordRawFrames = false;
         bool RecordProcessedVideo = false;
         std::string RecordVideoPath = "";
         bool ReadSetupFile = false;
         int WaitKeyDelay = 1;
+        bool BenchmarkColorFilter = false;
+        bool BenchmarkPreprocessing = false;
     }
 
     namespace Processing
@@ -48,6 +83,28 @@ namespace Setup
         double YOffset = 0;
         double ZOffset = 0;
         double ImageEdgeThreshold = 10;
+        bool YuyvNativeProcessing = false;
+        bool SkipUnchangedFrames = true;
+        std::string ColorFilter = "InRange";
+        int PreprocessingBands = 4;
+        bool BitPackedMorphology = false;
+        int PrescanRowStep = 0;
+        int DetectionScale = 1;
+        bool TrackRegionOfInterest = false;
+        int RegionOfInterestMargin = 48;
+        int RegionOfInterestMaxMisses = 3;
+    }
+
+    namespace Synthetic
+    {
+        int Seed = 1444;
+        double Distance = 3000;
+        double Height = -500;
+        double MotionAmplitude = 600;
+        double MotionPeriod = 4;
+        double NoiseStdDev = 4;
+        double BlurSigma = 0.8;
+        int DistractorCount = 4;
     }
 
     namespace HSVFilter
@@ -59,6 +116,7 @@ namespace Setup
         int HighS = 255;
         int HighV = 200;
         int MorphologyIterations = 1;
+        std::string ExtraClasses = "";
     }
 
     void SaveSetup()
@@ -67,24 +125,55 @@ namespace Setup
 
             // Camera
             ini.SetLongValue("Camera", "CameraId", Camera::CameraId);
+            ini.SetValue("Camera", "AdditionalCameraIds", Camera::AdditionalCameraIds.c_str());
             ini.SetLongValue("Camera", "Width", Camera::Width);
             ini.SetLongValue("Camera", "Height", Camera::Height);
+            ini.SetLongValue("Camera", "Fps", Camera::Fps);
+            ini.SetValue("Camera", "PixelFormat", Camera::PixelFormat.c_str());
+            ini.SetLongValue("Camera", "JpegScale", Camera::JpegScale);
+            ini.SetBoolValue("Camera", "AutoExposure", Camera::AutoExposure);
+            ini.SetLongValue("Camera", "Exposure", Camera::Exposure);
+            ini.SetBoolValue("Camera", "AutoGain", Camera::AutoGain);
+            ini.SetLongValue("Camera", "Gain", Camera::Gain);
+            ini.SetBoolValue("Camera", "AutoWhiteBalance", Camera::AutoWhiteBalance);
+            ini.SetLongValue("Camera", "Contrast", Camera::Contrast);
+            ini.SetBoolValue("Camera", "HorizontalFlip", Camera::HorizontalFlip);
+            ini.SetBoolValue("Camera", "VerticalFlip", Camera::VerticalFlip);
+            ini.SetLongValue("Camera", "DriverExposure", Camera::DriverExposure);
+            ini.SetLongValue("Camera", "TargetFramesPerDriverFrame", Camera::TargetFramesPerDriverFrame);
+            ini.SetLongValue("Camera", "ExposureLatencyFrames", Camera::ExposureLatencyFrames);
+            ini.SetBoolValue("Camera", "UseGStreamer", Camera::UseGStreamer);
+            ini.SetValue("Camera", "GStreamerPipeline", Camera::GStreamerPipeline.c_str());
 
             // Network
             ini.SetLongValue("Network", "DataPort", Network::DataPort);
 
+            // DriverStream
+            ini.SetLongValue("DriverStream", "Port", DriverStream::Port);
+            ini.SetDoubleValue("DriverStream", "Scale", DriverStream::Scale);
+            ini.SetLongValue("DriverStream", "JpegQuality", DriverStream::JpegQuality);
+
             // Diagnostics
+            ini.SetBoolValue("Diagnostics", "UseSyntheticImages", Diagnostics::UseSyntheticImages);
             ini.SetBoolValue("Diagnostics", "UseTestImage", Diagnostics::UseTestImage);  
             ini.SetValue("Diagnostics", "TestImagePath", Diagnostics::TestImagePath.c_str());   
+            ini.SetLongValue("Diagnostics", "ImageDecodeThreads", Diagnostics::ImageDecodeThreads);
+            ini.SetLongValue("Diagnostics", "ImagePrefetchDepth", Diagnostics::ImagePrefetchDepth);
             ini.SetBoolValue("Diagnostics", "UseTestVideo", Diagnostics::UseTestVideo);  
             ini.SetValue("Diagnostics", "TestVideoPath", Diagnostics::TestVideoPath.c_str());        
+            ini.SetBoolValue("Diagnostics", "UseTestRecording", Diagnostics::UseTestRecording);
+            ini.SetValue("Diagnostics", "TestRecordingPath", Diagnostics::TestRecordingPath.c_str());
+            ini.SetBoolValue("Diagnostics", "ReplayRealTime", Diagnostics::ReplayRealTime);
             ini.SetLongValue("Diagnostics", "LogLevel", (int)Diagnostics::LogLevel);
             ini.SetBoolValue("Diagnostics", "DisplayDebugImages", Diagnostics::DisplayDebugImages);     
             ini.SetBoolValue("Diagnostics", "RecordVideo", Diagnostics::RecordVideo);       
+            ini.SetBoolValue("Diagnostics", "RecordRawFrames", Diagnostics::RecordRawFrames);
             ini.SetBoolValue("Diagnostics", "RecordProcessedVideo", Diagnostics::RecordProcessedVideo); 
             ini.SetValue("Diagnostics", "RecordVideoPath", Diagnostics::RecordVideoPath.c_str());        
             ini.SetBoolValue("Diagnostics", "ReadSetupFile", Diagnostics::ReadSetupFile);   
             ini.SetLongValue("Diagnostics", "WaitKeyDelay", Diagnostics::WaitKeyDelay);   
+            ini.SetBoolValue("Diagnostics", "BenchmarkColorFilter", Diagnostics::BenchmarkColorFilter);
+            ini.SetBoolValue("Diagnostics", "BenchmarkPreprocessing", Diagnostics::BenchmarkPreprocessing);
 
             // Processing
             ini.SetLongValue("Processing", "ContourSizeThreshold", Processing::ContourSizeThreshold);
@@ -99,6 +188,26 @@ namespace Setup
             ini.SetDoubleValue("Processing", "YOffset", Processing::YOffset);
             ini.SetDoubleValue("Processing", "ZOffset", Processing::ZOffset);
             ini.SetDoubleValue("Processing", "ImageEdgeThreshold", Processing::ImageEdgeThreshold); 
+            ini.SetBoolValue("Processing", "YuyvNativeProcessing", Processing::YuyvNativeProcessing);
+            ini.SetBoolValue("Processing", "SkipUnchangedFrames", Processing::SkipUnchangedFrames);
+            ini.SetValue("Processing", "ColorFilter", Processing::ColorFilter.c_str());
+            ini.SetLongValue("Processing", "PreprocessingBands", Processing::PreprocessingBands);
+            ini.SetBoolValue("Processing", "BitPackedMorphology", Processing::BitPackedMorphology);
+            ini.SetLongValue("Processing", "PrescanRowStep", Processing::PrescanRowStep);
+            ini.SetLongValue("Processing", "DetectionScale", Processing::DetectionScale);
+            ini.SetBoolValue("Processing", "TrackRegionOfInterest", Processing::TrackRegionOfInterest);
+            ini.SetLongValue("Processing", "RegionOfInterestMargin", Processing::RegionOfInterestMargin);
+            ini.SetLongValue("Processing", "RegionOfInterestMaxMisses", Processing::RegionOfInterestMaxMisses);
+
+            // Synthetic
+            ini.SetLongValue("Synthetic", "Seed", Synthetic::Seed);
+            ini.SetDoubleValue("Synthetic", "Distance", Synthetic::Distance);
+            ini.SetDoubleValue("Synthetic", "Height", Synthetic::Height);
+            ini.SetDoubleValue("Synthetic", "MotionAmplitude", Synthetic::MotionAmplitude);
+            ini.SetDoubleValue("Synthetic", "MotionPeriod", Synthetic::MotionPeriod);
+            ini.SetDoubleValue("Synthetic", "NoiseStdDev", Synthetic::NoiseStdDev);
+            ini.SetDoubleValue("Synthetic", "BlurSigma", Synthetic::BlurSigma);
+            ini.SetLongValue("Synthetic", "DistractorCount", Synthetic::DistractorCount);
 
             // HSVFilter
             ini.SetLongValue("HSVFilter", "LowH", HSVFilter::LowH);
@@ -108,40 +217,102 @@ namespace Setup
             ini.SetLongValue("HSVFilter", "HighS", HSVFilter::HighS);
             ini.SetLongValue("HSVFilter", "HighV", HSVFilter::HighV);
             ini.SetLongValue("HSVFilter", "MorphologyIterations", HSVFilter::MorphologyIterations);
+            ini.SetValue("HSVFilter", "ExtraClasses", HSVFilter::ExtraClasses.c_str());
 
         // TODO create directories?
 
         ini.SaveFile(SetupPath.c_str(), true);
     }
 
+    SettingsMutex& GetMutex()
+    {
+        static SettingsMutex mutex;
+        return mutex;
+    }
+
+    static std::atomic<uint64_t> generation(0);
+
+    uint64_t GetGeneration()
+    {
+        return generation;
+    }
+
     void LoadSetup()
     {
+        // Only reload a changed file, so the camera threads aren't paused on every check
+        static struct stat lastStatus = {};
+
+        struct stat status = {};
+
+        if (stat(SetupPath.c_str(), &status) == 0 &&
+            status.st_mtim.tv_sec == lastStatus.st_mtim.tv_sec &&
+            status.st_mtim.tv_nsec == lastStatus.st_mtim.tv_nsec &&
+            status.st_size == lastStatus.st_size)
+        {
+            return;
+        }
+
+        lastStatus = status;
+
         CSimpleIniA ini;
 
         SI_Error result = ini.LoadFile(SetupPath.c_str());
 
         if (result == SI_Error::SI_OK)
         {
+            std::unique_lock<SettingsMutex> lock(GetMutex());
+
             // Camera
             Camera::CameraId = ini.GetLongValue("Camera", "CameraId", Camera::CameraId);
+            Camera::AdditionalCameraIds = ini.GetValue("Camera", "AdditionalCameraIds", Camera::AdditionalCameraIds.c_str());
             Camera::Width = ini.GetLongValue("Camera", "Width", Camera::Width);
             Camera::Height = ini.GetLongValue("Camera", "Height", Camera::Height);
+            Camera::Fps = ini.GetLongValue("Camera", "Fps", Camera::Fps);
+            Camera::PixelFormat = ini.GetValue("Camera", "PixelFormat", Camera::PixelFormat.c_str());
+            Camera::JpegScale = ini.GetLongValue("Camera", "JpegScale", Camera::JpegScale);
+            Camera::AutoExposure = ini.GetBoolValue("Camera", "AutoExposure", Camera::AutoExposure);
+            Camera::Exposure = ini.GetLongValue("Camera", "Exposure", Camera::Exposure);
+            Camera::AutoGain = ini.GetBoolValue("Camera", "AutoGain", Camera::AutoGain);
+            Camera::Gain = ini.GetLongValue("Camera", "Gain", Camera::Gain);
+            Camera::AutoWhiteBalance = ini.GetBoolValue("Camera", "AutoWhiteBalance", Camera::AutoWhiteBalance);
+            Camera::Contrast = ini.GetLongValue("Camera", "Contrast", Camera::Contrast);
+            Camera::HorizontalFlip = ini.GetBoolValue("Camera", "HorizontalFlip", Camera::HorizontalFlip);
+            Camera::VerticalFlip = ini.GetBoolValue("Camera", "VerticalFlip", Camera::VerticalFlip);
+            Camera::DriverExposure = ini.GetLongValue("Camera", "DriverExposure", Camera::DriverExposure);
+            Camera::TargetFramesPerDriverFrame = ini.GetLongValue("Camera", "TargetFramesPerDriverFrame", Camera::TargetFramesPerDriverFrame);
+            Camera::ExposureLatencyFrames = ini.GetLongValue("Camera", "ExposureLatencyFrames", Camera::ExposureLatencyFrames);
+            Camera::UseGStreamer = ini.GetBoolValue("Camera", "UseGStreamer", Camera::UseGStreamer);
+            Camera::GStreamerPipeline = ini.GetValue("Camera", "GStreamerPipeline", Camera::GStreamerPipeline.c_str());
 
             // Network
             Network::DataPort = ini.GetLongValue("Network", "DataPort", Network::DataPort);
 
+            // DriverStream
+            DriverStream::Port = ini.GetLongValue("DriverStream", "Port", DriverStream::Port);
+            DriverStream::Scale = ini.GetDoubleValue("DriverStream", "Scale", DriverStream::Scale);
+            DriverStream::JpegQuality = ini.GetLongValue("DriverStream", "JpegQuality", DriverStream::JpegQuality);
+
             // Diagnostics
+            Diagnostics::UseSyntheticImages = ini.GetBoolValue("Diagnostics", "UseSyntheticImages", Diagnostics::UseSyntheticImages);
             Diagnostics::UseTestImage = ini.GetBoolValue("Diagnostics", "UseTestImage", Diagnostics::UseTestImage);            
             Diagnostics::TestImagePath = ini.GetValue("Diagnostics", "TestImagePath", Diagnostics::TestImagePath.c_str());
+            Diagnostics::ImageDecodeThreads = ini.GetLongValue("Diagnostics", "ImageDecodeThreads", Diagnostics::ImageDecodeThreads);
+            Diagnostics::ImagePrefetchDepth = ini.GetLongValue("Diagnostics", "ImagePrefetchDepth", Diagnostics::ImagePrefetchDepth);
             Diagnostics::UseTestVideo = ini.GetBoolValue("Diagnostics", "UseTestVideo", Diagnostics::UseTestVideo);            
             Diagnostics::TestVideoPath = ini.GetValue("Diagnostics", "TestVideoPath", Diagnostics::TestVideoPath.c_str());
+            Diagnostics::UseTestRecording = ini.GetBoolValue("Diagnostics", "UseTestRecording", Diagnostics::UseTestRecording);
+            Diagnostics::TestRecordingPath = ini.GetValue("Diagnostics", "TestRecordingPath", Diagnostics::TestRecordingPath.c_str());
+            Diagnostics::ReplayRealTime = ini.GetBoolValue("Diagnostics", "ReplayRealTime", Diagnostics::ReplayRealTime);
             Diagnostics::LogLevel = (spdlog::level::level_enum)ini.GetLongValue("Diagnostics", "LogLevel", Diagnostics::LogLevel);
             Diagnostics::DisplayDebugImages = ini.GetBoolValue("Diagnostics", "DisplayDebugImages", Diagnostics::DisplayDebugImages);     
             Diagnostics::RecordVideo = ini.GetBoolValue("Diagnostics", "RecordVideo", Diagnostics::RecordVideo);   
+            Diagnostics::RecordRawFrames = ini.GetBoolValue("Diagnostics", "RecordRawFrames", Diagnostics::RecordRawFrames);
             Diagnostics::RecordProcessedVideo = ini.GetBoolValue("Diagnostics", "RecordProcessedVideo", Diagnostics::RecordProcessedVideo);       
             Diagnostics::RecordVideoPath = ini.GetValue("Diagnostics", "RecordVideoPath", Diagnostics::RecordVideoPath.c_str());                    
             Diagnostics::ReadSetupFile = ini.GetBoolValue("Diagnostics", "ReadSetupFile", Diagnostics::ReadSetupFile);      
             Diagnostics::WaitKeyDelay = ini.GetLongValue("Diagnostics", "WaitKeyDelay", Diagnostics::WaitKeyDelay);   
+            Diagnostics::BenchmarkColorFilter = ini.GetBoolValue("Diagnostics", "BenchmarkColorFilter", Diagnostics::BenchmarkColorFilter);
+            Diagnostics::BenchmarkPreprocessing = ini.GetBoolValue("Diagnostics", "BenchmarkPreprocessing", Diagnostics::BenchmarkPreprocessing);
 
 
             // Processing
@@ -157,6 +328,26 @@ namespace Setup
             Processing::YOffset = ini.GetDoubleValue("Processing", "YOffset", Processing::YOffset);
             Processing::ZOffset = ini.GetDoubleValue("Processing", "ZOffset", Processing::ZOffset);
             Processing::ImageEdgeThreshold = ini.GetDoubleValue("Processing", "ImageEdgeThreshold", Processing::ImageEdgeThreshold);
+            Processing::YuyvNativeProcessing = ini.GetBoolValue("Processing", "YuyvNativeProcessing", Processing::YuyvNativeProcessing);
+            Processing::SkipUnchangedFrames = ini.GetBoolValue("Processing", "SkipUnchangedFrames", Processing::SkipUnchangedFrames);
+            Processing::ColorFilter = ini.GetValue("Processing", "ColorFilter", Processing::ColorFilter.c_str());
+            Processing::PreprocessingBands = ini.GetLongValue("Processing", "PreprocessingBands", Processing::PreprocessingBands);
+            Processing::BitPackedMorphology = ini.GetBoolValue("Processing", "BitPackedMorphology", Processing::BitPackedMorphology);
+            Processing::PrescanRowStep = ini.GetLongValue("Processing", "PrescanRowStep", Processing::PrescanRowStep);
+            Processing::DetectionScale = ini.GetLongValue("Processing", "DetectionScale", Processing::DetectionScale);
+            Processing::TrackRegionOfInterest = ini.GetBoolValue("Processing", "TrackRegionOfInterest", Processing::TrackRegionOfInterest);
+            Processing::RegionOfInterestMargin = ini.GetLongValue("Processing", "RegionOfInterestMargin", Processing::RegionOfInterestMargin);
+            Processing::RegionOfInterestMaxMisses = ini.GetLongValue("Processing", "RegionOfInterestMaxMisses", Processing::RegionOfInterestMaxMisses);
+
+            // Synthetic
+            Synthetic::Seed = ini.GetLongValue("Synthetic", "Seed", Synthetic::Seed);
+            Synthetic::Distance = ini.GetDoubleValue("Synthetic", "Distance", Synthetic::Distance);
+            Synthetic::Height = ini.GetDoubleValue("Synthetic", "Height", Synthetic::Height);
+            Synthetic::MotionAmplitude = ini.GetDoubleValue("Synthetic", "MotionAmplitude", Synthetic::MotionAmplitude);
+            Synthetic::MotionPeriod = ini.GetDoubleValue("Synthetic", "MotionPeriod", Synthetic::MotionPeriod);
+            Synthetic::NoiseStdDev = ini.GetDoubleValue("Synthetic", "NoiseStdDev", Synthetic::NoiseStdDev);
+            Synthetic::BlurSigma = ini.GetDoubleValue("Synthetic", "BlurSigma", Synthetic::BlurSigma);
+            Synthetic::DistractorCount = ini.GetLongValue("Synthetic", "DistractorCount", Synthetic::DistractorCount);
 
             // HSVFilter
             HSVFilter::LowH = ini.GetLongValue("HSVFilter", "LowH", HSVFilter::LowH);
@@ -166,6 +357,9 @@ namespace Setup
             HSVFilter::HighS = ini.GetLongValue("HSVFilter", "HighS", HSVFilter::HighS);
             HSVFilter::HighV = ini.GetLongValue("HSVFilter", "HighV", HSVFilter::HighV);
             HSVFilter::MorphologyIterations = ini.GetLongValue("HSVFilter", "MorphologyIterations", HSVFilter::MorphologyIterations);
+            HSVFilter::ExtraClasses = ini.GetValue("HSVFilter", "ExtraClasses", HSVFilter::ExtraClasses.c_str());
+
+            ++generation;
         }
         else
         {
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
 #include <string>
 
 #include "spdlog/spdlog.h"
 
+#include "SettingsMutex.h"
+
 namespace Lightning
 {
 
@@ -12,6 +17,14 @@ namespace Setup
     const static std::string LogPath = "InfiniteRechargeVision.log";
     const static std::string SetupPath = "setup.ini";
 
+    // Held shared by the camera and capture threads while they use the settings for a frame,
+    // and exclusively by LoadSetup while it changes them
+    SettingsMutex& GetMutex();
+
+    // Bumped each time LoadSetup applies the file, so threads can tell when settings have changed
+    uint64_t GetGeneration();
+
+    // Reload the settings if the file has changed since it was last loaded
     void LoadSetup();
     void SaveSetup();
 
@@ -20,11 +33,59 @@ namespace Setup
         // Default camera id
         extern int CameraId;
 
+        // Comma-separated ids of further cameras to process alongside the default camera
+        extern std::string AdditionalCameraIds;
+
         // Image width
         extern int Width;
 
         // Image height
         extern int Height;
+
+        // Frame rate
+        extern int Fps;
+
+        // Pixel format fourcc (e.g. YUYV, MJPG) - falls back to another supported format if unavailable
+        extern std::string PixelFormat;
+
+        // Decode MJPEG frames at 1/JpegScale of full size (1, 2, 4 or 8)
+        extern int JpegScale;
+
+        // Let the camera set exposure - always off when exposures alternate
+        extern bool AutoExposure;
+
+        // Exposure for target frames - short exposures keep motion blur and the frame interval down
+        extern int Exposure;
+
+        // Let the camera set gain
+        extern bool AutoGain;
+
+        // Gain when automatic gain is off
+        extern int Gain;
+
+        // Let the camera set white balance
+        extern bool AutoWhiteBalance;
+
+        extern int Contrast;
+
+        extern bool HorizontalFlip;
+
+        extern bool VerticalFlip;
+
+        // Exposure for driver frames
+        extern int DriverExposure;
+
+        // Number of target frames captured between each driver frame - 0 captures target frames only
+        extern int TargetFramesPerDriverFrame;
+
+        // Frames between setting the exposure and the first frame captured with it
+        extern int ExposureLatencyFrames;
+
+        // Capture with a GStreamer pipeline instead of V4L2 - needs a build with USE_GSTREAMER
+        extern bool UseGStreamer;
+
+        // GStreamer pipeline ending in an appsink named sink - {id} is replaced by the camera ID
+        extern std::string GStreamerPipeline;
     }
 
     namespace Network
@@ -33,20 +94,50 @@ namespace Setup
         extern int DataPort;
     }
 
+    namespace DriverStream
+    {
+        // Port driver frames are published on
+        extern int Port;
+
+        // Scale of the published frames relative to the camera frames
+        extern double Scale;
+
+        // JPEG quality of the published frames
+        extern int JpegQuality;
+    }
+
     namespace Diagnostics
     {
+        // Use rendered synthetic target images instead of camera
+        extern bool UseSyntheticImages;
+
         // Use saved image instead of camera
         extern bool UseTestImage;
 
-        // Path to test image
+        // Path to test image - a single image, a directory or a glob pattern such as images/*.png
         extern std::string TestImagePath;
 
+        // Number of threads decoding test images ahead of processing
+        extern int ImageDecodeThreads;
+
+        // Maximum number of test images decoded ahead of processing
+        extern int ImagePrefetchDepth;
+
         // Use saved video instead of camera
         extern bool UseTestVideo;
 
         // Path to test video
         extern std::string TestVideoPath;
 
+        // Use raw frame recording instead of camera
+        extern bool UseTestRecording;
+
+        // Path to raw frame recording
+        extern std::string TestRecordingPath;
+
+        // Replay raw frame recording with its original timing instead of as fast as possible
+        extern bool ReplayRealTime;
+
         // Log Level
         extern spdlog::level::level_enum LogLevel;
 
@@ -56,6 +147,9 @@ namespace Setup
         // Record and save raw video for diagnostics
         extern bool RecordVideo;
 
+        // Record raw frames in their source format instead of MJPEG video
+        extern bool RecordRawFrames;
+
         // Record and save processed video
         extern bool RecordProcessedVideo;
 
@@ -67,6 +161,12 @@ namespace Setup
 
         // Wait time for displaying images - 0 will pause the display until a key is pressed
         extern int WaitKeyDelay;
+
+        // Time each color filter against cvtColor and inRange on every BGR frame and log the results
+        extern bool BenchmarkColorFilter;
+
+        // Time preprocessing on every frame with each band count from 1 to PreprocessingBands and log the results
+        extern bool BenchmarkPreprocessing;
     }
 
     namespace Processing
@@ -106,8 +206,75 @@ namespace Setup
 
         // Distance from edge of image before contour is rejected
         extern double ImageEdgeThreshold;
+
+        // Classify color and take gray directly from YUYV frames instead of converting to BGR - off by
+        // default. The YUV color classes only approximate the HSV thresholds, so pixels near a threshold
+        // can be classified differently.
+        extern bool YuyvNativeProcessing;
+
+        // Republish the previous result instead of reprocessing a frame identical to the last one.
+        // Images are compared for file, image directory and synthetic sources. Live cameras are only
+        // skipped when the driver re-delivers the same buffer - a stalled sensor that repeats its last
+        // image under new sequence numbers is still processed.
+        extern bool SkipUnchangedFrames;
+
+        // Color filter for BGR frames - InRange, the default, converts to HSV and calls inRange, Fused
+        // thresholds HSV in one pass, Lookup uses a table quantized to 6 bits per channel
+        extern std::string ColorFilter;
+
+        // Number of row bands converted and filtered in parallel - one thread each, including the processing thread
+        extern int PreprocessingBands;
+
+        // Close the mask packed to one bit per pixel instead of with morphologyEx - the result is the
+        // same. Off by default.
+        extern bool BitPackedMorphology;
+
+        // Classify every Nth row first and skip frames with nothing in range - off when 0, the default.
+        // This is lossy: a target shorter than N frame rows, such as one far away, can fall between the
+        // sampled rows and the frame is reported as having no target.
+        extern int PrescanRowStep;
+
+        // Threshold, close and find contours on the frame downscaled by this factor - 1, 2 or 4.
+        // Corners are still refined at full resolution.
+        extern int DetectionScale;
+
+        // Once targets are found, only search the box around them grown by a margin in pixels - off by
+        // default. Targets that appear outside the box are missed until RegionOfInterestMaxMisses frames
+        // pass without a target.
+        extern bool TrackRegionOfInterest;
+        extern int RegionOfInterestMargin;
+
+        // Consecutive frames without targets before searching the whole frame again
+        extern int RegionOfInterestMaxMisses;
     }
     
+    namespace Synthetic
+    {
+        // Random seed - the same seed always renders the same frames
+        extern int Seed;
+
+        // Distance from camera to target in millimeters
+        extern double Distance;
+
+        // Height of target relative to camera in millimeters - negative is above
+        extern double Height;
+
+        // Side to side camera motion in millimeters
+        extern double MotionAmplitude;
+
+        // Period of camera motion in seconds
+        extern double MotionPeriod;
+
+        // Standard deviation of pixel noise
+        extern double NoiseStdDev;
+
+        // Gaussian blur sigma in pixels
+        extern double BlurSigma;
+
+        // Number of distractor blobs per frame
+        extern int DistractorCount;
+    }
+
     namespace HSVFilter
     {
         // Low Hue limit
@@ -130,6 +297,11 @@ namespace Setup
 
         // Number of morphology iterations
         extern int MorphologyIterations;
+
+        // Other colors labelled in the same pass as the target color and shown as debug images - up to 7 as
+        // "name lowH lowS lowV highH highS highV", separated by ';'. While labelling, the target color is
+        // classified with the lookup tables and region of interest tracking is off.
+        extern std::string ExtraClasses;
     }
 }
 
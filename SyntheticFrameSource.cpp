@@ -0,0 +1,140 @@
+#include "SyntheticFrameSource.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Same depth as the V4L2 buffer queue
+    const int BufferCount = 4;
+
+    // Sub-pixel bits used when filling polygons
+    const int DrawShift = 4;
+
+    const cv::Scalar BackgroundColor(25, 25, 25);
+
+    // Lit retroreflective tape - inside the default HSV filter
+    const cv::Scalar TapeColor(60, 190, 70);
+}
+
+SyntheticFrameSource::SyntheticFrameSource(std::vector<spdlog::sink_ptr> sinks, std::unique_ptr<TargetModel> targetModel, std::unique_ptr<CameraModel> cameraModel)
+    : _targetModel(std::move(targetModel))
+    , _cameraModel(std::move(cameraModel))
+    , _frameRate(60)
+    , _sequence(0)
+    , _isOpened(false)
+{
+    _logger = std::make_shared<spdlog::logger>("SyntheticFrameSource", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+}
+
+bool SyntheticFrameSource::Open()
+{
+    _size = cv::Size(Setup::Camera::Width, Setup::Camera::Height);
+    _frameRate = Setup::Camera::Fps > 0 ? Setup::Camera::Fps : 60;
+    _pool = std::make_shared<BufferPool>(BufferCount);
+    _sequence = 0;
+    _isOpened = true;
+
+    _logger->info("Rendering synthetic frames {0}x{1} with seed {2}", _size.width, _size.height, Setup::Synthetic::Seed);
+
+    return true;
+}
+
+bool SyntheticFrameSource::Read(Frame& frame)
+{
+    if (!_isOpened)
+    {
+        return false;
+    }
+
+    cv::Mat rvec, tvec;
+    GetPose(_sequence, rvec, tvec);
+
+    int index = _pool->Acquire();
+
+    Render(_pool->GetBuffer(index), _sequence, rvec, tvec);
+
+    _pool->Attach(frame, index);
+    frame.format = PixelFormat::BGR;
+    frame.timestamp = std::chrono::steady_clock::now();
+    frame.sequence = _sequence++;
+    frame.truthRvec = rvec;
+    frame.truthTvec = tvec;
+
+    return true;
+}
+
+void SyntheticFrameSource::GetPose(uint64_t sequence, cv::Mat& rvec, cv::Mat& tvec) const
+{
+    // Camera motion is a function of time only, so each frame is the same on every run
+    double t = sequence / _frameRate;
+    double phase = 2 * CV_PI * t / std::max(0.1, Setup::Synthetic::MotionPeriod);
+    double amplitude = Setup::Synthetic::MotionAmplitude;
+
+    // Sway side to side while closing and opening distance, and yaw a little with it
+    tvec = (cv::Mat_<double>(3, 1) <<
+        amplitude * std::sin(phase),
+        Setup::Synthetic::Height,
+        Setup::Synthetic::Distance + 0.5 * amplitude * std::cos(phase));
+
+    double yaw = 0.15 * std::sin(phase + 1.0);
+
+    // The model's x axis runs right to left across the image and its z axis points away from the camera
+    cv::Mat facing;
+    cv::Rodrigues(cv::Vec3d(0, CV_PI + yaw, 0), facing);
+
+    cv::Mat pitch;
+    cv::Rodrigues(cv::Vec3d(std::atan2(-Setup::Synthetic::Height, Setup::Synthetic::Distance), 0, 0), pitch);
+
+    cv::Rodrigues(pitch * facing, rvec);
+}
+
+void SyntheticFrameSource::Render(cv::Mat& image, uint64_t sequence, const cv::Mat& rvec, const cv::Mat& tvec) const
+{
+    cv::RNG rng(Setup::Synthetic::Seed + sequence);
+
+    image.create(_size, CV_8UC3);
+    image.setTo(BackgroundColor);
+
+    // Distractors - some tape colored but the wrong shape, some the wrong color
+    for (int i = 0; i < Setup::Synthetic::DistractorCount; ++i)
+    {
+        cv::Point center(rng.uniform(0, _size.width), rng.uniform(0, _size.height));
+        cv::Size axes(rng.uniform(3, 40), rng.uniform(3, 40));
+
+        cv::Scalar color = (i % 2 == 0) ? TapeColor : cv::Scalar(rng.uniform(0, 255), rng.uniform(0, 255), rng.uniform(0, 255));
+
+        cv::ellipse(image, center, axes, rng.uniform(0, 180), 0, 360, color, cv::FILLED, cv::LINE_AA);
+    }
+
+    // Tape strip corners, in drawing order around the strip
+    std::vector<cv::Point3d> keyPoints = _targetModel->GetSubTargetKeyPoints(0);
+    std::vector<cv::Point3d> strip { keyPoints[0], keyPoints[1], keyPoints[3], keyPoints[2] };
+
+    std::vector<cv::Point2d> projected;
+    cv::projectPoints(strip, rvec, tvec, _cameraModel->GetCameraMatrix(_size), _cameraModel->GetDistanceCoefficients(), projected);
+
+    std::vector<cv::Point> polygon;
+
+    for (auto& point : projected)
+    {
+        polygon.push_back(cv::Point(cvRound(point.x * (1 << DrawShift)), cvRound(point.y * (1 << DrawShift))));
+    }
+
+    cv::fillConvexPoly(image, polygon, TapeColor, cv::LINE_AA, DrawShift);
+
+    if (Setup::Synthetic::BlurSigma > 0)
+    {
+        cv::GaussianBlur(image, image, cv::Size(0, 0), Setup::Synthetic::BlurSigma);
+    }
+
+    if (Setup::Synthetic::NoiseStdDev > 0)
+    {
+        // Zero-mean noise, offset to fit in 8 bits
+        cv::Mat noise(_size, CV_8UC3);
+        rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(128), cv::Scalar::all(Setup::Synthetic::NoiseStdDev));
+
+        cv::addWeighted(image, 1.0, noise, 1.0, -128, image);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+
+#include "spdlog/spdlog.h"
+
+#include "FrameSource.h"
+#include "BufferPool.h"
+#include "TargetModel.h"
+#include "CameraModel.h"
+
+namespace Lightning
+{
+
+// Renders the target model as tape strips at known poses, with configurable noise, blur,
+// distractor blobs and camera motion. Every frame is deterministic for a given seed and
+// carries its ground-truth pose, so throughput and pose error can be measured without a camera.
+class SyntheticFrameSource : public FrameSource
+{
+public:
+
+    SyntheticFrameSource(std::vector<spdlog::sink_ptr>, std::unique_ptr<TargetModel>, std::unique_ptr<CameraModel>);
+
+    virtual bool Open();
+
+    virtual bool IsOpened() const { return _isOpened; }
+
+    virtual bool Read(Frame&);
+
+    virtual void Release() { _isOpened = false; }
+
+    virtual bool IsLive() const { return false; }
+
+    virtual bool CanReconnect() const { return false; }
+
+    virtual cv::Size GetFrameSize() const { return _size; }
+
+    virtual double GetFrameRate() const { return _frameRate; }
+
+private:
+
+    // Camera-to-target transform for a frame
+    void GetPose(uint64_t, cv::Mat&, cv::Mat&) const;
+
+    void Render(cv::Mat&, uint64_t, const cv::Mat&, const cv::Mat&) const;
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::unique_ptr<TargetModel> _targetModel;
+    std::unique_ptr<CameraModel> _cameraModel;
+
+    std::shared_ptr<BufferPool> _pool;
+
+    cv::Size _size;
+    double _frameRate;
+
+    uint64_t _sequence;
+
+    bool _isOpened;
+};
+
+}
@@ -1,63 +1,153 @@
+#include <sstream>
+
 #include "TargetFinder.h"
 #include "CameraModel.h"
 #include "TargetModel.h"
 #include "Setup.h"
 #include "VisionData.hpp"
+#include "HsvThreshold.h"
+#include "BinaryMask.h"
 
 using namespace Lightning;
 
 TargetFinder::TargetFinder(std::vector<spdlog::sink_ptr> sinks, std::string name, std::unique_ptr<TargetModel> targetModel, std::unique_ptr<CameraModel> cameraModel, cv::Vec3d offsets)
     : _targetModel(std::move(targetModel))
     , _cameraModel(std::move(cameraModel))
-    , _name(name)
+    , _yuvColorTable(ColorLookupTable::Space::Yuv)
+    , _bgrColorTable(ColorLookupTable::Space::Bgr)
+    , _yuvLabelTable(ColorLookupTable::Space::Yuv)
+    , _bgrLabelTable(ColorLookupTable::Space::Bgr)
     , _offset(offsets)
+    , _poseErrorCount(0)
+    , _translationErrorSum(0)
+    , _translationErrorMax(0)
+    , _rotationErrorSum(0)
+    , _rotationErrorMax(0)
+    , _benchmarkCount(0)
+    , _benchmarkTwoStepTicks(0)
+    , _benchmarkFusedTicks(0)
+    , _benchmarkLookupTicks(0)
+    , _benchmarkMismatches(0)
+    , _benchmarkLookupMismatches(0)
+    , _benchmarkBandCount(0)
+    , _searchRegionMisses(0)
+    , _name(name)
 {
     _logger = std::make_shared<spdlog::logger>(name, sinks.begin(), sinks.end());
     _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+
+    // The processing thread works on a band too
+    _threadPool = std::make_unique<ThreadPool>(std::max(1, Setup::Processing::PreprocessingBands) - 1);
+}
+
+bool TargetFinder::Process(const Frame& frame, std::vector<VisionData>& data)
+{
+    std::vector<Target> targets;
+
+    return Process(frame, data, targets);
 }
 
-bool TargetFinder::Process(cv::Mat& image, std::vector<VisionData>& data)
+bool TargetFinder::Process(const Frame& frame, std::vector<VisionData>& data, std::vector<Target>& targets)
 {
-    // Convert image to HSV and gray
-    cv::Mat hsvImage, grayImage;
-    ConvertImage(image, hsvImage, grayImage);
+    targets.clear();
+
+    cv::Scalar low(Setup::HSVFilter::LowH, Setup::HSVFilter::LowS, Setup::HSVFilter::LowV);
+    cv::Scalar high(Setup::HSVFilter::HighH, Setup::HSVFilter::HighS, Setup::HSVFilter::HighV);
+
+    UpdateColorClasses(low, high);
 
-    // Filter based on color
-    cv::Mat rangedImage;
+    if (Setup::Diagnostics::BenchmarkPreprocessing)
+    {
+        BenchmarkPreprocessing(frame, low, high);
+    }
+
+    // Search only around where targets were last seen, if they were seen recently
+    cv::Rect region = GetSearchRegion(frame);
+    bool tracking = region.size() != frame.image.size();
+
+    Frame regionFrame = frame;
+    regionFrame.image = frame.image(region);
+
+    // Skip the rest of the frame if a sample of its rows has nothing in range
+    if (Setup::Processing::PrescanRowStep > 0 && !Prescan(regionFrame, low, high, Setup::Processing::PrescanRowStep))
+    {
+        _logger->trace("Process(): Nothing in range in prescan.");
+        UpdateSearchRegion(std::vector<Target>(), frame.image.size());
+        return false;
+    }
+
+    // Image corners are refined on at full resolution - gray is only made for the small regions around them
+    cv::Mat cornerImage;
+    PixelFormat cornerFormat;
 
-    FilterOnColor(hsvImage, rangedImage, cv::Scalar(Setup::HSVFilter::LowH, Setup::HSVFilter::LowS, Setup::HSVFilter::LowV), cv::Scalar(Setup::HSVFilter::HighH, Setup::HSVFilter::HighS, Setup::HSVFilter::HighV), Setup::HSVFilter::MorphologyIterations);
+    // Detect on a downscaled frame if configured
+    int scale = std::max(1, Setup::Processing::DetectionScale);
 
-    // Detect contours
+    Frame detectionFrame = regionFrame;
+    cv::Point sampleOffset(0, 0);
+
+    if (scale > 1 && !Downscale(regionFrame, scale, detectionFrame, cornerImage, cornerFormat, sampleOffset))
+    {
+        _logger->error("Process(): Unable to downscale frame.");
+        return false;
+    }
+
+    // Convert and filter based on color
+    cv::Mat image, rangedImage, labels;
+
+    if (!Preprocess(detectionFrame, low, high, Setup::Processing::PreprocessingBands, image, rangedImage, labels))
+    {
+        _logger->error("Process(): Unable to convert frame.");
+        return false;
+    }
+
+    if (scale == 1)
+    {
+        // YUYV frames filtered directly have no BGR image, so use the Y plane
+        cornerImage = image.empty() ? regionFrame.image : image;
+        cornerFormat = image.empty() ? PixelFormat::YUYV : PixelFormat::BGR;
+    }
+
+    // Compressed frames are always searched whole, and are only sized once decoded
+    cv::Size imageSize = frame.format == PixelFormat::MJPG ? cornerImage.size() : frame.image.size();
+
+    // Detect contours - in full resolution frame coordinates from here on
     std::vector<std::vector<cv::Point>> contours;
 
-    if (!FindContours(rangedImage, contours))
+    if (!FindContours(rangedImage, contours, region.tl() + sampleOffset, scale))
     {
         // No contours, so nothing to process
+        UpdateSearchRegion(std::vector<Target>(), imageSize);
         return false;
     }
 
     // Approximate contours
     std::vector<std::vector<cv::Point>> approx(contours.size());
-    cv::Mat contourImage = cv::Mat(image.size(), CV_8UC1);
+    cv::Mat contourImage = cv::Mat(imageSize, CV_8UC1);
 
     ApproximateContours(contours, approx, contourImage);
 
     // Find target sections
     std::vector<TargetSection> targetSections;
 
-    TargetSectionsFromContours(approx, targetSections, cv::Size(image.cols, image.rows));
-    //TargetSectionsFromContours(contours, targetSections, cv::Size(image.cols, image.rows));
+    TargetSectionsFromContours(approx, targetSections, imageSize);
+    //TargetSectionsFromContours(contours, targetSections, imageSize);
 
     // Create targets from sections
-    std::vector<Target> targets;
-
     SortTargetSections(targetSections, targets);
 
     // Get subpixel measurement on target corners
-    RefineTargetCorners(targets, grayImage);
+    RefineTargetCorners(targets, cornerImage, cornerFormat, region.tl());
+
+    UpdateSearchRegion(targets, imageSize);
 
     // Find the camera to target tranform
-    FindTargetTransforms(targets, cv::Size(image.cols, image.rows));
+    FindTargetTransforms(targets, imageSize);
+
+    if (!frame.truthTvec.empty())
+    {
+        MeasurePoseError(targets, frame);
+    }
 
     // Sort targets by horizontal position in image
     std::sort(targets.begin(), targets.end(), [](Target t1, Target t2){ return (t1.data.imageX < t2.data.imageX); });
@@ -66,55 +156,627 @@ bool TargetFinder::Process(cv::Mat& image, std::vector<VisionData>& data)
     for (int i = 0; i < (int)targets.size(); ++i)
     {
         targets[i].data.targetId = i;
+        targets[i].data.captureTime = frame.GetTimestampMicroseconds();
+        targets[i].data.sequence = frame.sequence;
 
         data.push_back(targets[i].data);
     }
 
     if (Setup::Diagnostics::DisplayDebugImages)
     {
-        DrawDebugImage(image, targets);
+        // The image may be a source buffer that is handed back once the frame is released, so draw on a copy
+        cv::Mat debugImage;
+
+        if (image.size() != imageSize)
+        {
+            frame.ConvertToBgr(debugImage);
+
+            // BGR frames convert without copying
+            if (frame.format == PixelFormat::BGR)
+            {
+                debugImage = debugImage.clone();
+            }
+        }
+        else
+        {
+            debugImage = image.clone();
+        }
+
+        DrawDebugImage(debugImage, targets);
+
+        if (tracking)
+        {
+            cv::rectangle(debugImage, region, cv::Scalar(255, 255, 0), 1);
+        }
+
+        std::lock_guard<std::mutex> lock(_debugImageMutex);
 
         _debugImages.clear();
-        _debugImages.push_back(std::make_pair("Raw", image));
+        _debugImages.push_back(std::make_pair("Raw", debugImage));
         _debugImages.push_back(std::make_pair("Contours", contourImage));
         _debugImages.push_back(std::make_pair("Ranged", rangedImage));
+
+        for (size_t k = 1; k < _colorClasses.size(); ++k)
+        {
+            cv::Mat classMask;
+            ColorLookupTable::ExtractClass(labels, k, classMask);
+
+            _debugImages.push_back(std::make_pair(_colorClasses[k].name, classMask));
+        }
+    }
+
+    return true;
+}
+
+void TargetFinder::UpdateColorClasses(const cv::Scalar low, const cv::Scalar high)
+{
+    if (_colorClasses.empty() || Setup::HSVFilter::ExtraClasses != _extraClassSetting)
+    {
+        _extraClassSetting = Setup::HSVFilter::ExtraClasses;
+
+        // The target color is always class 0
+        _colorClasses.assign(1, ColorClass{ "Target", low, high });
+
+        // Each class is "name lowH lowS lowV highH highS highV", separated by ';'
+        std::stringstream setting(_extraClassSetting);
+        std::string entry;
+
+        while (std::getline(setting, entry, ';'))
+        {
+            std::stringstream fields(entry);
+            ColorClass colorClass;
+
+            if (!(fields >> colorClass.name))
+            {
+                continue;
+            }
+
+            if (!(fields >> colorClass.low[0] >> colorClass.low[1] >> colorClass.low[2] >> colorClass.high[0] >> colorClass.high[1] >> colorClass.high[2]))
+            {
+                _logger->error("UpdateColorClasses(): Unable to parse color class '{0}'", entry);
+                continue;
+            }
+
+            if (_colorClasses.size() >= ColorLookupTable::MaxClasses)
+            {
+                _logger->error("UpdateColorClasses(): Only {0} color classes can be labelled, ignoring '{1}'", ColorLookupTable::MaxClasses, colorClass.name);
+                continue;
+            }
+
+            _colorClasses.push_back(colorClass);
+        }
+
+        _logger->info("Labelling {0} extra color classes", _colorClasses.size() - 1);
+
+        if (_colorClasses.size() > 1)
+        {
+            // Labelling changes how targets are detected, so say so
+            if (Setup::Processing::TrackRegionOfInterest)
+            {
+                _logger->warn("Region of interest tracking is off while extra color classes are labelled");
+            }
+
+            if (Setup::Processing::ColorFilter != "Lookup")
+            {
+                _logger->warn("Target color is classified with the lookup table instead of the {0} filter while extra color classes are labelled", Setup::Processing::ColorFilter);
+            }
+        }
+    }
+
+    _colorClasses[0].low = low;
+    _colorClasses[0].high = high;
+}
+
+void TargetFinder::UpdateColorTables(bool yuyvNative, const cv::Scalar low, const cv::Scalar high)
+{
+    if (_colorClasses.size() > 1)
+    {
+        if ((yuyvNative ? _yuvLabelTable : _bgrLabelTable).Update(_colorClasses))
+        {
+            _logger->debug("Rebuilt color label table");
+        }
+    }
+    else if (yuyvNative)
+    {
+        if (_yuvColorTable.Update(low, high))
+        {
+            _logger->debug("Rebuilt YUV color table");
+        }
+    }
+    else if (Setup::Processing::ColorFilter == "Lookup")
+    {
+        if (_bgrColorTable.Update(low, high))
+        {
+            _logger->debug("Rebuilt BGR color table");
+        }
+    }
+}
+
+bool TargetFinder::Prescan(const Frame& frame, const cv::Scalar low, const cv::Scalar high, int rowStep)
+{
+    // Compressed frames would have to be decoded to be sampled
+    if (frame.format == PixelFormat::MJPG || frame.image.empty())
+    {
+        return true;
+    }
+
+    // View of every rowStep-th row, starting half a step in - nothing is copied
+    int first = std::min(rowStep / 2, frame.image.rows - 1);
+    int count = (frame.image.rows - first + rowStep - 1) / rowStep;
+
+    cv::Mat rows(count, frame.image.cols, frame.image.type(), const_cast<uchar*>(frame.image.ptr(first)), frame.image.step * rowStep);
+
+    // Classify the same way as the full frame - with other classes, pixels in any of them keep the frame
+    bool yuyvNative = frame.format == PixelFormat::YUYV && Setup::Processing::YuyvNativeProcessing;
+    bool labelling = _colorClasses.size() > 1;
+
+    UpdateColorTables(yuyvNative, low, high);
+
+    cv::Mat mask;
+
+    if (yuyvNative)
+    {
+        (labelling ? _yuvLabelTable : _yuvColorTable).ClassifyYuyv(rows, mask);
+    }
+    else
+    {
+        cv::Mat bgr;
+
+        switch (frame.format)
+        {
+            case PixelFormat::YUYV:
+                cv::cvtColor(rows, bgr, cv::COLOR_YUV2BGR_YUYV);
+                break;
+
+            case PixelFormat::GREY:
+                cv::cvtColor(rows, bgr, cv::COLOR_GRAY2BGR);
+                break;
+
+            default:
+                bgr = rows;
+                break;
+        }
+
+        if (labelling)
+        {
+            _bgrLabelTable.ClassifyBgr(bgr, mask);
+        }
+        else
+        {
+            FilterOnColor(bgr, mask, low, high);
+        }
+    }
+
+    return cv::countNonZero(mask) > 0;
+}
+
+bool TargetFinder::Downscale(const Frame& frame, int scale, Frame& scaled, cv::Mat& full, PixelFormat& fullFormat, cv::Point& sampleOffset)
+{
+    if (frame.image.empty())
+    {
+        return false;
+    }
+
+    scaled = frame;
+
+    switch (frame.format)
+    {
+        case PixelFormat::YUYV:
+        {
+            // Keep every scale-th pixel of every scale-th row, so scaled pixel (x, y) is exactly full
+            // pixel (x, y) * scale. Resizing the pairs would keep both pixels of a pair and put every
+            // other pixel a pixel or more off that grid. Each pair takes the chroma of its first pixel.
+            int cols = (frame.image.cols / scale) & ~1;
+            int rows = frame.image.rows / scale;
+
+            scaled.image = cv::Mat(rows, cols, CV_8UC2);
+
+            for (int y = 0; y < rows; ++y)
+            {
+                const uchar* src = frame.image.ptr<uchar>(y * scale);
+                uchar* dst = scaled.image.ptr<uchar>(y);
+
+                for (int x = 0; x < cols; x += 2, dst += 4)
+                {
+                    // Y of pixel c is byte 2c - x is even, so its pixel starts a pair and U and V follow
+                    const uchar* first = src + 2 * x * scale;
+
+                    dst[0] = first[0];
+                    dst[1] = first[1];
+                    dst[2] = src[2 * (x + 1) * scale];
+                    dst[3] = first[3];
+                }
+            }
+
+            full = frame.image;
+            fullFormat = PixelFormat::YUYV;
+            sampleOffset = cv::Point(0, 0);
+            break;
+        }
+
+        case PixelFormat::GREY:
+            cv::resize(frame.image, scaled.image, cv::Size(frame.image.cols / scale, frame.image.rows / scale), 0, 0, cv::INTER_AREA);
+            full = frame.image;
+            fullFormat = PixelFormat::GREY;
+
+            // Each scaled pixel averages a scale x scale block - the nearest whole pixel to its center
+            sampleOffset = cv::Point(scale / 2, scale / 2);
+            break;
+
+        default:
+            // Compressed frames have to be decoded at full resolution anyway
+            if (!frame.ConvertToBgr(full))
+            {
+                return false;
+            }
+
+            cv::resize(full, scaled.image, cv::Size(full.cols / scale, full.rows / scale), 0, 0, cv::INTER_AREA);
+            scaled.format = PixelFormat::BGR;
+            fullFormat = PixelFormat::BGR;
+            sampleOffset = cv::Point(scale / 2, scale / 2);
+            break;
+    }
+
+    return !scaled.image.empty();
+}
+
+bool TargetFinder::Preprocess(const Frame& frame, const cv::Scalar low, const cv::Scalar high, int bands, cv::Mat& image, cv::Mat& ranged, cv::Mat& labels)
+{
+    if (frame.image.empty())
+    {
+        return false;
+    }
+
+    // YUYV is filtered straight from the frame - no BGR or HSV conversions
+    bool yuyvNative = frame.format == PixelFormat::YUYV && Setup::Processing::YuyvNativeProcessing;
+
+    // Other color classes are labelled in the same pass, and the target mask taken from the labels
+    bool labelling = _colorClasses.size() > 1;
+
+    // The lookup tables are shared by the bands, so bring them up to date first
+    UpdateColorTables(yuyvNative, low, high);
+
+    if (!yuyvNative)
+    {
+        if (frame.format == PixelFormat::BGR)
+        {
+            image = frame.image;
+        }
+        else if (frame.format == PixelFormat::YUYV || frame.format == PixelFormat::GREY)
+        {
+            image.create(frame.image.size(), CV_8UC3);
+        }
+        else if (!frame.ConvertToBgr(image))
+        {
+            // Compressed frames can't be split into bands, so decode them whole
+            return false;
+        }
+    }
+
+    cv::Size size = yuyvNative ? frame.image.size() : image.size();
+
+    bands = std::max(1, std::min(bands, size.height));
+
+    auto bandRows = [size, bands](int band)
+    {
+        return cv::Range(size.height * band / bands, size.height * (band + 1) / bands);
+    };
+
+    // Convert and filter based on color - each band only touches its own rows
+    cv::Mat mask(size, CV_8UC1);
+
+    if (labelling)
+    {
+        labels.create(size, CV_8UC1);
+    }
+    else
+    {
+        labels.release();
     }
 
+    _threadPool->Run(bands, [&](int band)
+    {
+        cv::Range rows = bandRows(band);
+        cv::Mat bandMask = mask.rowRange(rows);
+
+        if (labelling)
+        {
+            cv::Mat bandLabels = labels.rowRange(rows);
+
+            if (yuyvNative)
+            {
+                _yuvLabelTable.ClassifyYuyv(frame.image.rowRange(rows), bandLabels);
+            }
+            else
+            {
+                cv::Mat bandImage = image.rowRange(rows);
+
+                ConvertBand(frame, rows, bandImage);
+                _bgrLabelTable.ClassifyBgr(bandImage, bandLabels);
+            }
+
+            ColorLookupTable::ExtractClass(bandLabels, 0, bandMask);
+        }
+        else if (yuyvNative)
+        {
+            _yuvColorTable.ClassifyYuyv(frame.image.rowRange(rows), bandMask);
+        }
+        else
+        {
+            cv::Mat bandImage = image.rowRange(rows);
+
+            ConvertBand(frame, rows, bandImage);
+            FilterOnColor(bandImage, bandMask, low, high);
+        }
+    });
+
+    if (Setup::Diagnostics::BenchmarkColorFilter && !yuyvNative)
+    {
+        BenchmarkColorFilter(image, low, high);
+    }
+
+    int iterations = Setup::HSVFilter::MorphologyIterations;
+
+    if (iterations <= 0)
+    {
+        ranged = mask;
+        return true;
+    }
+
+    // Close disconnected contours. Each band also closes the rows either side that the close
+    // can reach from, so the stitched mask is the same as closing the whole mask at once.
+    int overlap = 2 * iterations;
+
+    ranged.create(size, CV_8UC1);
+
+    _threadPool->Run(bands, [&](int band)
+    {
+        cv::Range rows = bandRows(band);
+        cv::Range extended(std::max(0, rows.start - overlap), std::min(size.height, rows.end + overlap));
+
+        cv::Range inner(rows.start - extended.start, rows.end - extended.start);
+        cv::Mat bandRanged = ranged.rowRange(rows);
+
+        if (Setup::Processing::BitPackedMorphology)
+        {
+            // Close with one bit per pixel, then unpack for findContours
+            BinaryMask bits(mask.rowRange(extended));
+
+            bits.Close(iterations);
+            bits.Unpack(bandRanged, inner);
+        }
+        else
+        {
+            cv::Mat closed;
+            cv::morphologyEx(mask.rowRange(extended), closed, cv::MORPH_CLOSE, cv::Mat(), cv::Point(-1,-1), iterations);
+
+            closed.rowRange(inner).copyTo(bandRanged);
+        }
+    });
+
     return true;
 }
 
-void TargetFinder::ConvertImage(const cv::Mat& image, cv::Mat& hsv, cv::Mat& gray)
+void TargetFinder::ConvertBand(const Frame& frame, const cv::Range& rows, cv::Mat& image)
+{
+    // Convert the source format to BGR
+    switch (frame.format)
+    {
+        case PixelFormat::YUYV:
+            cv::cvtColor(frame.image.rowRange(rows), image, cv::COLOR_YUV2BGR_YUYV);
+            break;
+
+        case PixelFormat::GREY:
+            cv::cvtColor(frame.image.rowRange(rows), image, cv::COLOR_GRAY2BGR);
+            break;
+
+        default:
+            // Already BGR
+            break;
+    }
+}
+
+void TargetFinder::FilterOnColor(const cv::Mat& bgr, cv::Mat& ranged, const cv::Scalar low, const cv::Scalar high)
+{
+    if (Setup::Processing::ColorFilter == "Lookup")
+    {
+        // One table lookup per pixel
+        _bgrColorTable.ClassifyBgr(bgr, ranged);
+    }
+    else if (Setup::Processing::ColorFilter == "InRange")
+    {
+        cv::Mat hsv;
+        cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+        cv::inRange(hsv, low, high, ranged);
+    }
+    else
+    {
+        // One pass straight from BGR to the mask
+        ThresholdHsv(bgr, low, high, ranged);
+    }
+}
+
+void TargetFinder::BenchmarkPreprocessing(const Frame& frame, const cv::Scalar low, const cv::Scalar high)
+{
+    const int SummaryInterval = 100;
+
+    int maxBands = _threadPool->GetWorkerCount() + 1;
+
+    _benchmarkBandTicks.resize(maxBands, 0);
+
+    for (int bands = 1; bands <= maxBands; ++bands)
+    {
+        cv::Mat image, ranged, labels;
+
+        int64_t start = cv::getTickCount();
+
+        Preprocess(frame, low, high, bands, image, ranged, labels);
+
+        _benchmarkBandTicks[bands - 1] += cv::getTickCount() - start;
+    }
+
+    if (++_benchmarkBandCount >= SummaryInterval)
+    {
+        double singleMs = 1000.0 * _benchmarkBandTicks[0] / cv::getTickFrequency() / _benchmarkBandCount;
+
+        std::string summary;
+
+        for (int bands = 1; bands <= maxBands; ++bands)
+        {
+            double ms = 1000.0 * _benchmarkBandTicks[bands - 1] / cv::getTickFrequency() / _benchmarkBandCount;
+
+            summary += fmt::format("{0}{1} {2:.3f} ms {3:.0f} fps ({4:.1f}x)", bands > 1 ? ", " : "", bands, ms, 1000.0 / ms, singleMs / ms);
+        }
+
+        _logger->info("Preprocessing over {0} {1}x{2} frames by band count: {3}", _benchmarkBandCount, frame.image.cols, frame.image.rows, summary);
+
+        _benchmarkBandCount = 0;
+        std::fill(_benchmarkBandTicks.begin(), _benchmarkBandTicks.end(), 0);
+    }
+}
+
+void TargetFinder::BenchmarkColorFilter(const cv::Mat& bgr, const cv::Scalar low, const cv::Scalar high)
+{
+    const int SummaryInterval = 100;
+
+    int64_t start = cv::getTickCount();
+
+    cv::Mat hsv, twoStep;
+    cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+    cv::inRange(hsv, low, high, twoStep);
+
+    int64_t middle = cv::getTickCount();
+
+    cv::Mat fused;
+    ThresholdHsv(bgr, low, high, fused);
+
+    int64_t fusedEnd = cv::getTickCount();
+
+    // Rebuilding the table is not part of the per-frame cost
+    _bgrColorTable.Update(low, high);
+
+    int64_t lookupStart = cv::getTickCount();
+
+    cv::Mat lookup;
+    _bgrColorTable.ClassifyBgr(bgr, lookup);
+
+    int64_t end = cv::getTickCount();
+
+    // The fused mask should be identical - any difference is a bug in the fused kernel. The lookup
+    // table classifies each cell by its center, so it differs near the edges of the color range.
+    cv::Mat difference;
+    cv::compare(twoStep, fused, difference, cv::CMP_NE);
+    _benchmarkMismatches += cv::countNonZero(difference);
+
+    cv::compare(twoStep, lookup, difference, cv::CMP_NE);
+    _benchmarkLookupMismatches += cv::countNonZero(difference);
+
+    ++_benchmarkCount;
+    _benchmarkTwoStepTicks += middle - start;
+    _benchmarkFusedTicks += fusedEnd - middle;
+    _benchmarkLookupTicks += end - lookupStart;
+
+    if (_benchmarkCount >= SummaryInterval)
+    {
+        double twoStepMs = 1000.0 * _benchmarkTwoStepTicks / cv::getTickFrequency() / _benchmarkCount;
+        double fusedMs = 1000.0 * _benchmarkFusedTicks / cv::getTickFrequency() / _benchmarkCount;
+        double lookupMs = 1000.0 * _benchmarkLookupTicks / cv::getTickFrequency() / _benchmarkCount;
+
+        _logger->info("Color filter over {0} {1}x{2} frames: cvtColor + inRange {3:.3f} ms, fused {4:.3f} ms ({5:.1f}x, {6} mismatched pixels), lookup {7:.3f} ms ({8:.1f}x, {9} mismatched pixels)",
+            _benchmarkCount, bgr.cols, bgr.rows, twoStepMs,
+            fusedMs, twoStepMs / fusedMs, _benchmarkMismatches,
+            lookupMs, twoStepMs / lookupMs, _benchmarkLookupMismatches);
+
+        _benchmarkCount = 0;
+        _benchmarkTwoStepTicks = 0;
+        _benchmarkFusedTicks = 0;
+        _benchmarkLookupTicks = 0;
+        _benchmarkMismatches = 0;
+        _benchmarkLookupMismatches = 0;
+    }
+}
+
+cv::Rect TargetFinder::GetSearchRegion(const Frame& frame)
 {
-    // Convert image to HSV and gray
-    cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
+    cv::Rect full(cv::Point(0, 0), frame.image.size());
+
+    // Compressed frames have to be decoded whole, and other color classes are labelled over the whole frame
+    if (!Setup::Processing::TrackRegionOfInterest || _searchRegion.area() <= 0 || frame.format == PixelFormat::MJPG || _colorClasses.size() > 1)
+    {
+        return full;
+    }
+
+    // Frame size can change if the camera is reconnected
+    cv::Rect region = _searchRegion & full;
+
+    if (region.area() <= 0)
+    {
+        return full;
+    }
+
+    // YUYV pixels come in pairs that share chroma
+    if (frame.format == PixelFormat::YUYV)
+    {
+        int right = std::min(full.width, region.x + region.width + 1) & ~1;
+        region.x &= ~1;
+        region.width = right - region.x;
+    }
 
-    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    return region;
 }
 
-void TargetFinder::FilterOnColor(const cv::Mat& hsv, cv::Mat& ranged, const cv::Scalar low, const cv::Scalar high, const int iter)
+void TargetFinder::UpdateSearchRegion(const std::vector<Target>& targets, const cv::Size& imageSize)
 {
-    // Filter based on color
-    cv::inRange(hsv, low, high, ranged);
+    if (!Setup::Processing::TrackRegionOfInterest)
+    {
+        return;
+    }
 
-    // Close disconnected contours
-    cv::morphologyEx(ranged, ranged, cv::MORPH_CLOSE, cv::Mat(), cv::Point(-1,-1), iter);
+    std::vector<cv::Point2f> corners;
 
-    // Blur?
+    for (auto& target : targets)
+    {
+        for (auto& section : target.sections)
+        {
+            corners.insert(corners.end(), section.corners.begin(), section.corners.end());
+        }
+    }
+
+    if (corners.empty())
+    {
+        // Go back to searching the whole frame after too many misses
+        if (_searchRegion.area() > 0 && ++_searchRegionMisses >= Setup::Processing::RegionOfInterestMaxMisses)
+        {
+            _logger->debug("Lost targets after {0} frames, searching full frame", _searchRegionMisses);
+            _searchRegion = cv::Rect();
+        }
+
+        return;
+    }
+
+    // Grow the box around every corner by the margin so targets are still inside it next frame
+    int margin = Setup::Processing::RegionOfInterestMargin;
+
+    cv::Rect bounds = cv::boundingRect(corners);
+    bounds = cv::Rect(bounds.x - margin, bounds.y - margin, bounds.width + 2 * margin, bounds.height + 2 * margin);
+
+    _searchRegion = bounds & cv::Rect(cv::Point(0, 0), imageSize);
+    _searchRegionMisses = 0;
 }
 
-bool TargetFinder::FindContours(const cv::Mat& image, std::vector<std::vector<cv::Point>>& contours)
+bool TargetFinder::FindContours(const cv::Mat& image, std::vector<std::vector<cv::Point>>& contours, const cv::Point& offset, int scale)
 {
     // Find contours
     std::vector<cv::Vec4i> hierarchy;
 
     cv::findContours(image, contours, hierarchy, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
-    // Filter out small contours
+    // Filter out small contours - there are fewer contour points on a downscaled image
     std::vector<std::vector<cv::Point>>::iterator itc = contours.begin();
 
     while (itc != contours.end())
     {
-        if (itc->size() < Setup::Processing::ContourSizeThreshold)
+        if (itc->size() * scale < Setup::Processing::ContourSizeThreshold)
         {
             itc = contours.erase(itc);
         }
@@ -124,6 +786,15 @@ bool TargetFinder::FindContours(const cv::Mat& image, std::vector<std::vector<cv
         }
     }
 
+    // Move points to the full resolution pixels they were sampled from, in frame coordinates
+    for (auto& contour : contours)
+    {
+        for (auto& point : contour)
+        {
+            point = point * scale + offset;
+        }
+    }
+
     if (contours.size() <= 0)
     {
         _logger->debug("FindContours(): No contours found 1.");
@@ -214,9 +885,9 @@ void TargetFinder::TargetSectionsFromContours(const std::vector<std::vector<cv::
             double imageEdgeThreshold = Setup::Processing::ImageEdgeThreshold;
             
             if (rect.center.x < imageEdgeThreshold || 
-                rect.center.x > Setup::Camera::Width - imageEdgeThreshold || 
+                rect.center.x > size.width - imageEdgeThreshold || 
                 rect.center.y < imageEdgeThreshold ||
-                rect.center.y > Setup::Camera::Height - imageEdgeThreshold)
+                rect.center.y > size.height - imageEdgeThreshold)
             {
                 continue;
             }
@@ -271,8 +942,15 @@ void TargetFinder::SortTargetSections(const std::vector<TargetSection>& sections
     }
 }
 
-void TargetFinder::RefineTargetCorners(std::vector<Target>& targets, const cv::Mat& image)
+void TargetFinder::RefineTargetCorners(std::vector<Target>& targets, const cv::Mat& image, PixelFormat format, const cv::Point& origin)
 {
+    const cv::Size window(5, 5);
+
+    // Room around the corners for the search window, and for corners to move as they are refined
+    const int margin = 2 * window.width + 1;
+
+    cv::Rect imageRect(origin, image.size());
+
     for (auto& target : targets)
     {   
         target.center = cv::Point2f(0,0);
@@ -287,7 +965,39 @@ void TargetFinder::RefineTargetCorners(std::vector<Target>& targets, const cv::M
 
             try
             {
-                cv::cornerSubPix(image, section.corners, cv::Size(5,5), cv::Size(-1,-1), cv::TermCriteria(cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS, Setup::Processing::MaxCornerSubPixelIterations, Setup::Processing::CornerSubPixelThreshold));
+                // Gray for just the region around this section's corners
+                cv::Rect region = cv::boundingRect(section.corners);
+                region = cv::Rect(region.x - margin, region.y - margin, region.width + 2 * margin, region.height + 2 * margin) & imageRect;
+
+                cv::Mat gray;
+
+                if (format == PixelFormat::YUYV)
+                {
+                    cv::extractChannel(image(region - origin), gray, 0);
+                }
+                else if (format == PixelFormat::GREY)
+                {
+                    gray = image(region - origin);
+                }
+                else
+                {
+                    cv::cvtColor(image(region - origin), gray, cv::COLOR_BGR2GRAY);
+                }
+
+                cv::Point2f offset(region.x, region.y);
+                std::vector<cv::Point2f> regionCorners;
+
+                for (auto& corner : section.corners)
+                {
+                    regionCorners.push_back(corner - offset);
+                }
+
+                cv::cornerSubPix(gray, regionCorners, window, cv::Size(-1,-1), cv::TermCriteria(cv::TermCriteria::MAX_ITER | cv::TermCriteria::EPS, Setup::Processing::MaxCornerSubPixelIterations, Setup::Processing::CornerSubPixelThreshold));
+
+                for (size_t i = 0; i < regionCorners.size(); ++i)
+                {
+                    section.corners[i] = regionCorners[i] + offset;
+                }
             }
             catch (cv::Exception ex)
             {
@@ -381,7 +1091,7 @@ void TargetFinder::FindTargetTransforms(std::vector<Target>& targets, const cv::
         }
 
         // Find transform
-        bool solved = cv::solvePnP(keyPoints, imagePoints, _cameraModel->GetCameraMatrix(), _cameraModel->GetDistanceCoefficients(), rvec, tvec, true, cv::SOLVEPNP_AP3P);
+        bool solved = cv::solvePnP(keyPoints, imagePoints, _cameraModel->GetCameraMatrix(imageSize), _cameraModel->GetDistanceCoefficients(), rvec, tvec, true, cv::SOLVEPNP_AP3P);
 
         if (!solved)
         {
@@ -475,6 +1185,8 @@ double TargetFinder::Distance(const cv::Point2d& pt1, const cv::Point2d& pt2)
 
 void TargetFinder::ShowDebugImages()
 {
+    std::lock_guard<std::mutex> lock(_debugImageMutex);
+
     for (auto& image : _debugImages)
     {
         auto windowName = fmt::format("{0} {1}",_name, image.first);
@@ -541,7 +1253,7 @@ void TargetFinder::DrawDebugImage(cv::Mat& image, const std::vector<Target>& tar
         
         std::vector<cv::Point2d> projectedPoints;
         //cv::projectPoints(_targetModel->GetSubTargetKeyPoints(0), rvec, tvec, _cameraModel->GetCameraMatrix(), _cameraModel->GetDistanceCoefficients(), projectedPoints);       
-        cv::projectPoints(_targetModel->GetKeyPoints(), rvec, tvec, _cameraModel->GetCameraMatrix(), _cameraModel->GetDistanceCoefficients(), projectedPoints);       
+        cv::projectPoints(_targetModel->GetKeyPoints(), rvec, tvec, _cameraModel->GetCameraMatrix(image.size()), _cameraModel->GetDistanceCoefficients(), projectedPoints);       
 
         //cv::circle(image, targets[target].center, 5, color, 1, cv::LINE_AA);
         
@@ -608,4 +1320,62 @@ void TargetFinder::DrawDebugImage(cv::Mat& image, const std::vector<Target>& tar
     cv::putText(image, fmt::format("Average Theta: {:03.1f}", averageTheta), cv::Point(10,30 + 400), cv::FONT_HERSHEY_PLAIN, 1.0, cv::Scalar(255,255,255));
 
 
-}
\ No newline at end of file
+}
+
+void TargetFinder::MeasurePoseError(const std::vector<Target>& targets, const Frame& frame)
+{
+    const int SummaryInterval = 100;
+
+    for (auto& target : targets)
+    {
+        if (target.data.status != VisionStatus::TargetFound)
+        {
+            continue;
+        }
+
+        // Undo the world coordinate and camera-to-robot adjustments to get back to the camera-to-target solution
+        cv::Mat rvec = target.rvec.clone();
+        cv::Mat tvec = target.tvec.clone();
+
+        if (Setup::Processing::UseWorldCoordinates)
+        {
+            target.GetInverseTransforms(rvec, tvec);
+        }
+
+        tvec.at<double>(0,0) += _offset[0];
+        tvec.at<double>(1,0) += _offset[1];
+        tvec.at<double>(2,0) += _offset[2];
+
+        double translationError = cv::norm(tvec, frame.truthTvec);
+
+        // Angle of the rotation between the solution and the truth
+        cv::Mat R, truthR;
+        cv::Rodrigues(rvec, R);
+        cv::Rodrigues(frame.truthRvec, truthR);
+
+        cv::Mat difference;
+        cv::Rodrigues(R * truthR.t(), difference);
+
+        double rotationError = (180 / CV_PI) * cv::norm(difference);
+
+        _logger->trace("Pose error frame {0}: {1:.1f} mm {2:.2f} deg", frame.sequence, translationError, rotationError);
+
+        ++_poseErrorCount;
+        _translationErrorSum += translationError;
+        _translationErrorMax = std::max(_translationErrorMax, translationError);
+        _rotationErrorSum += rotationError;
+        _rotationErrorMax = std::max(_rotationErrorMax, rotationError);
+
+        if (_poseErrorCount >= SummaryInterval)
+        {
+            _logger->debug("Pose error over {0} targets: translation mean {1:.1f} mm max {2:.1f} mm, rotation mean {3:.2f} deg max {4:.2f} deg",
+                _poseErrorCount, _translationErrorSum / _poseErrorCount, _translationErrorMax, _rotationErrorSum / _poseErrorCount, _rotationErrorMax);
+
+            _poseErrorCount = 0;
+            _translationErrorSum = 0;
+            _translationErrorMax = 0;
+            _rotationErrorSum = 0;
+            _rotationErrorMax = 0;
+        }
+    }
+}
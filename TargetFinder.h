@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 
 #include <opencv2/opencv.hpp>
 #include "spdlog/spdlog.h"
@@ -9,6 +10,9 @@
 #include "CameraModel.h"
 #include "VisionData.hpp"
 #include "Target.h"
+#include "Frame.h"
+#include "ColorLookupTable.h"
+#include "ThreadPool.h"
 
 namespace Lightning
 {
@@ -20,17 +24,54 @@ public:
 
     TargetFinder(std::vector<spdlog::sink_ptr>, std::string, std::unique_ptr<TargetModel>, std::unique_ptr<CameraModel>, cv::Vec3d);
 
-    bool Process(cv::Mat&, std::vector<VisionData>&);
+    bool Process(const Frame&, std::vector<VisionData>&);
+
+    // Also returns the targets found, with their corners refined in frame coordinates
+    bool Process(const Frame&, std::vector<VisionData>&, std::vector<Target>&);
 
     void ShowDebugImages();
 
+    // Convert and color filter the frame in row bands on the thread pool, then close the mask. The
+    // image is set to the frame as BGR, or left empty when YUYV is filtered directly. Labels are
+    // only set when there are extra color classes. Any band count gives the same result.
+    bool Preprocess(const Frame&, const cv::Scalar, const cv::Scalar, int bands, cv::Mat& image, cv::Mat& ranged, cv::Mat& labels);
+
 private:
 
-    void ConvertImage(const cv::Mat&, cv::Mat&, cv::Mat&);
+    // Rebuild the color classes if the extra classes setting has changed, and set the target color bounds
+    void UpdateColorClasses(const cv::Scalar, const cv::Scalar);
+
+    // Rebuild the lookup table the frame will be classified with if the bounds have changed
+    void UpdateColorTables(bool yuyvNative, const cv::Scalar, const cv::Scalar);
+
+    // Classify every rowStep-th row - returns false if none of them has a pixel in range
+    bool Prescan(const Frame&, const cv::Scalar, const cv::Scalar, int rowStep);
+
+    // Downscale the frame for detection, keeping the full resolution image corners are refined on. The
+    // sample offset is the full resolution pixel the scaled image's top left pixel stands for.
+    bool Downscale(const Frame&, int scale, Frame& scaled, cv::Mat& full, PixelFormat& fullFormat, cv::Point& sampleOffset);
+
+    // Convert one band of the frame to BGR
+    void ConvertBand(const Frame&, const cv::Range&, cv::Mat&);
+
+    // Color filter one band of a BGR image
+    void FilterOnColor(const cv::Mat&, cv::Mat&, const cv::Scalar, const cv::Scalar);
 
-    void FilterOnColor(const cv::Mat&, cv::Mat&, const cv::Scalar, const cv::Scalar, const int iter);
+    // Time preprocessing with every band count from 1 to the size of the thread pool
+    void BenchmarkPreprocessing(const Frame&, const cv::Scalar, const cv::Scalar);
 
-    bool FindContours(const cv::Mat&, std::vector<std::vector<cv::Point>>&);
+    // Time the fused HSV threshold and the lookup table against cvtColor and inRange on the same image
+    void BenchmarkColorFilter(const cv::Mat&, const cv::Scalar, const cv::Scalar);
+
+    // Region of the frame to search - around the last targets while tracking, otherwise the whole frame
+    cv::Rect GetSearchRegion(const Frame&);
+
+    // Track the region around the found targets, or give it up after too many frames without any
+    void UpdateSearchRegion(const std::vector<Target>&, const cv::Size&);
+
+    // Contours are scaled and offset from the mask into full resolution frame coordinates - mask pixel
+    // (x, y) is frame pixel (x, y) * scale + offset
+    bool FindContours(const cv::Mat&, std::vector<std::vector<cv::Point>>&, const cv::Point& offset, int scale);
 
     void ApproximateContours(const std::vector<std::vector<cv::Point>>&, std::vector<std::vector<cv::Point>>&, cv::Mat&);
 
@@ -40,7 +81,8 @@ private:
 
     void SortTargetSections(const std::vector<TargetSection>&, std::vector<Target>&);
 
-    void RefineTargetCorners(std::vector<Target>&, const cv::Mat&);
+    // Refine corners on gray made only around each section - the image is BGR, YUYV or GREY, with its top left at origin in the frame
+    void RefineTargetCorners(std::vector<Target>&, const cv::Mat&, PixelFormat, const cv::Point& origin);
 
     void FindTargetTransforms(std::vector<Target>&, const cv::Size&);
 
@@ -52,15 +94,55 @@ private:
 
     void DrawDebugImage(cv::Mat&, const std::vector<Target>&);
 
+    // Compare found targets against the frame's ground-truth pose, if it has one
+    void MeasurePoseError(const std::vector<Target>&, const Frame&);
+
     std::shared_ptr<spdlog::logger> _logger;
 
     std::unique_ptr<TargetModel> _targetModel;
     std::unique_ptr<CameraModel> _cameraModel;
 
+    // Color classifiers for YUYV and BGR frames
+    ColorLookupTable _yuvColorTable;
+    ColorLookupTable _bgrColorTable;
+
+    // Target color and the extra color classes, labelled in one pass with a bit per class
+    std::vector<ColorClass> _colorClasses;
+    std::string _extraClassSetting;
+    ColorLookupTable _yuvLabelTable;
+    ColorLookupTable _bgrLabelTable;
+
+    // Written by the processing thread, shown by the display thread
     std::vector<std::pair<std::string, cv::Mat>> _debugImages;
+    std::mutex _debugImageMutex;
 
     cv::Vec3d _offset;
 
+    // Pose error against ground truth, summarized periodically
+    int _poseErrorCount;
+    double _translationErrorSum;
+    double _translationErrorMax;
+    double _rotationErrorSum;
+    double _rotationErrorMax;
+
+    // Color filter benchmark, summarized periodically
+    int _benchmarkCount;
+    int64_t _benchmarkTwoStepTicks;
+    int64_t _benchmarkFusedTicks;
+    int64_t _benchmarkLookupTicks;
+    int64_t _benchmarkMismatches;
+    int64_t _benchmarkLookupMismatches;
+
+    // Preprocessing time by band count, summarized periodically
+    int _benchmarkBandCount;
+    std::vector<int64_t> _benchmarkBandTicks;
+
+    std::unique_ptr<ThreadPool> _threadPool;
+
+    // Region targets are expected in next frame - empty when searching the whole frame
+    cv::Rect _searchRegion;
+    int _searchRegionMisses;
+
     std::string _name;
 };
 
@@ -0,0 +1,114 @@
+#include "ThreadPool.h"
+
+using namespace Lightning;
+
+ThreadPool::ThreadPool(int workers)
+    : _task(nullptr)
+    , _count(0)
+    , _next(0)
+    , _remaining(0)
+    , _batch(0)
+    , _stop(false)
+{
+    for (int i = 0; i < workers; ++i)
+    {
+        _workers.push_back(std::thread(&ThreadPool::Worker, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+
+    _workCondition.notify_all();
+
+    for (auto& worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Run(int count, const std::function<void(int)>& task)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _task = &task;
+    _count = count;
+    _next = 0;
+    _remaining = count;
+    _exception = nullptr;
+    ++_batch;
+
+    _workCondition.notify_all();
+
+    RunTasks(lock);
+
+    _doneCondition.wait(lock, [this]{ return _remaining == 0; });
+
+    _task = nullptr;
+
+    if (_exception)
+    {
+        std::exception_ptr exception = _exception;
+        _exception = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::Worker()
+{
+    uint64_t batch = 0;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (true)
+    {
+        _workCondition.wait(lock, [this, batch]{ return _stop || _batch != batch; });
+
+        if (_stop)
+        {
+            return;
+        }
+
+        batch = _batch;
+
+        RunTasks(lock);
+    }
+}
+
+void ThreadPool::RunTasks(std::unique_lock<std::mutex>& lock)
+{
+    while (_task && _next < _count)
+    {
+        int index = _next++;
+        const std::function<void(int)>& task = *_task;
+
+        lock.unlock();
+
+        std::exception_ptr exception;
+
+        try
+        {
+            task(index);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        lock.lock();
+
+        if (exception && !_exception)
+        {
+            _exception = exception;
+        }
+
+        if (--_remaining == 0)
+        {
+            _doneCondition.notify_all();
+        }
+    }
+}
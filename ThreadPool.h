@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Lightning
+{
+
+// Persistent worker threads for splitting per-frame work into tasks. The calling thread
+// works on tasks too, so a pool of N - 1 workers keeps N cores busy.
+class ThreadPool
+{
+public:
+
+    ThreadPool(int workers);
+    ~ThreadPool();
+
+    // Run task(0) to task(count - 1) and wait for them all - rethrows the first exception a task throws
+    void Run(int count, const std::function<void(int)>& task);
+
+    int GetWorkerCount() const { return (int)_workers.size(); }
+
+private:
+
+    void Worker();
+
+    // Run tasks from the current batch until none are left to claim
+    void RunTasks(std::unique_lock<std::mutex>&);
+
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _workCondition;
+    std::condition_variable _doneCondition;
+
+    // Current batch
+    const std::function<void(int)>* _task;
+    int _count;
+    int _next;
+    int _remaining;
+    uint64_t _batch;
+    std::exception_ptr _exception;
+
+    bool _stop;
+};
+
+}
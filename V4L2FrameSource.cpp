@@ -0,0 +1,702 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+
+#include "V4L2FrameSource.h"
+#include "Setup.h"
+
+using namespace Lightning;
+
+namespace
+{
+    // Enough buffers for one being filled, one in the mailbox, one being processed and one spare
+    const unsigned int BufferCount = 4;
+
+    // Time to wait for a frame before treating the device as stalled
+    const int ReadTimeoutMs = 1000;
+
+    // Corrupt buffers in a row before treating the device as broken
+    const int MaxErrorBuffers = 8;
+
+    int xioctl(int fd, unsigned long request, void* arg)
+    {
+        int result;
+
+        do
+        {
+            result = ioctl(fd, request, arg);
+        } while (result == -1 && errno == EINTR);
+
+        return result;
+    }
+
+    bool PixelFormatFromFourcc(uint32_t fourcc, PixelFormat& format)
+    {
+        switch (fourcc)
+        {
+            case V4L2_PIX_FMT_YUYV:
+                format = PixelFormat::YUYV;
+                return true;
+            case V4L2_PIX_FMT_MJPEG:
+                format = PixelFormat::MJPG;
+                return true;
+            case V4L2_PIX_FMT_GREY:
+                format = PixelFormat::GREY;
+                return true;
+            case V4L2_PIX_FMT_BGR24:
+                format = PixelFormat::BGR;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    std::string FourccToString(uint32_t fourcc)
+    {
+        return std::string {
+            (char)(fourcc & 0xff),
+            (char)((fourcc >> 8) & 0xff),
+            (char)((fourcc >> 16) & 0xff),
+            (char)((fourcc >> 24) & 0xff)
+        };
+    }
+
+    uint32_t FourccFromString(const std::string& s)
+    {
+        std::string padded = s + "    ";
+        return v4l2_fourcc(padded[0], padded[1], padded[2], padded[3]);
+    }
+}
+
+struct V4L2FrameSource::Device
+{
+    std::mutex mutex;
+    int fd = -1;
+    bool streaming = false;
+    std::vector<std::pair<void*, size_t>> buffers;
+
+    ~Device()
+    {
+        for (auto& buffer : buffers)
+        {
+            munmap(buffer.first, buffer.second);
+        }
+
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    void Requeue(unsigned int index)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!streaming)
+        {
+            return;
+        }
+
+        v4l2_buffer buf {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = index;
+
+        xioctl(fd, VIDIOC_QBUF, &buf);
+    }
+};
+
+V4L2FrameSource::V4L2FrameSource(std::vector<spdlog::sink_ptr> sinks, int cameraId)
+    : _path(fmt::format("/dev/video{0}", cameraId))
+    , _format(PixelFormat::YUYV)
+    , _bytesPerLine(0)
+    , _frameRate(0)
+    , _controlsGeneration(0)
+    , _scheduleStarted(false)
+    , _scheduleStart(0)
+    , _appliedExposure(ExposureClass::TargetExposure)
+{
+    _logger = std::make_shared<spdlog::logger>("V4L2FrameSource", sinks.begin(), sinks.end());
+    _logger->set_level(Lightning::Setup::Diagnostics::LogLevel);
+}
+
+V4L2FrameSource::~V4L2FrameSource()
+{
+    Release();
+}
+
+bool V4L2FrameSource::Open()
+{
+    Release();
+
+    _device = std::make_shared<Device>();
+
+    _device->fd = open(_path.c_str(), O_RDWR | O_NONBLOCK);
+
+    if (_device->fd < 0)
+    {
+        _logger->error("Failed to open {0}: {1}", _path, std::strerror(errno));
+        _device.reset();
+        return false;
+    }
+
+    v4l2_capability capability {};
+
+    if (xioctl(_device->fd, VIDIOC_QUERYCAP, &capability) < 0 ||
+        !(capability.capabilities & V4L2_CAP_VIDEO_CAPTURE) ||
+        !(capability.capabilities & V4L2_CAP_STREAMING))
+    {
+        _logger->error("{0} does not support streaming capture", _path);
+        _device.reset();
+        return false;
+    }
+
+    if (!NegotiateFormat())
+    {
+        _device.reset();
+        return false;
+    }
+
+    if (!RequestBuffers())
+    {
+        _device.reset();
+        return false;
+    }
+
+    // Applied on every open, so a camera that resets and reconnects gets its controls back
+    ApplyControls();
+
+    // Alternating exposures start on the target exposure
+    _scheduleStarted = false;
+    _appliedExposure = ExposureClass::TargetExposure;
+
+    if (Setup::Camera::TargetFramesPerDriverFrame > 0)
+    {
+        _logger->info("Alternating exposure {0} and {1}, {2} target frames per driver frame",
+            Setup::Camera::Exposure, Setup::Camera::DriverExposure, Setup::Camera::TargetFramesPerDriverFrame);
+    }
+
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    if (xioctl(_device->fd, VIDIOC_STREAMON, &type) < 0)
+    {
+        _logger->error("VIDIOC_STREAMON failed: {0}", std::strerror(errno));
+        _device.reset();
+        return false;
+    }
+
+    _device->streaming = true;
+
+    return true;
+}
+
+bool V4L2FrameSource::NegotiateFormat()
+{
+    int fd = _device->fd;
+
+    // Use the requested pixel format if the device has it, otherwise the first one we can handle
+    uint32_t requestedFourcc = FourccFromString(Setup::Camera::PixelFormat);
+    uint32_t fourcc = 0;
+
+    v4l2_fmtdesc formatDescription {};
+    formatDescription.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    for (formatDescription.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &formatDescription) == 0; ++formatDescription.index)
+    {
+        PixelFormat format;
+
+        if (!PixelFormatFromFourcc(formatDescription.pixelformat, format))
+        {
+            continue;
+        }
+
+        if (fourcc == 0 || formatDescription.pixelformat == requestedFourcc)
+        {
+            fourcc = formatDescription.pixelformat;
+        }
+    }
+
+    if (fourcc == 0)
+    {
+        _logger->error("{0} has no supported pixel formats", _path);
+        return false;
+    }
+
+    if (fourcc != requestedFourcc)
+    {
+        _logger->warn("Pixel format {0} is not supported, using {1}", Setup::Camera::PixelFormat, FourccToString(fourcc));
+    }
+
+    // Find the closest frame size
+    cv::Size requestedSize(Setup::Camera::Width, Setup::Camera::Height);
+    cv::Size size = requestedSize;
+
+    v4l2_frmsizeenum frameSize {};
+    frameSize.pixel_format = fourcc;
+
+    int bestSizeError = -1;
+
+    for (frameSize.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frameSize) == 0; ++frameSize.index)
+    {
+        cv::Size candidate;
+
+        if (frameSize.type == V4L2_FRMSIZE_TYPE_DISCRETE)
+        {
+            candidate = cv::Size(frameSize.discrete.width, frameSize.discrete.height);
+        }
+        else
+        {
+            // Stepwise or continuous - the driver will round the requested size itself
+            candidate = cv::Size(
+                std::max((int)frameSize.stepwise.min_width, std::min((int)frameSize.stepwise.max_width, requestedSize.width)),
+                std::max((int)frameSize.stepwise.min_height, std::min((int)frameSize.stepwise.max_height, requestedSize.height)));
+        }
+
+        int error = std::abs(candidate.width - requestedSize.width) + std::abs(candidate.height - requestedSize.height);
+
+        if (bestSizeError < 0 || error < bestSizeError)
+        {
+            bestSizeError = error;
+            size = candidate;
+        }
+
+        if (frameSize.type != V4L2_FRMSIZE_TYPE_DISCRETE)
+        {
+            break;
+        }
+    }
+
+    // Find the closest frame interval for that size
+    double requestedFps = Setup::Camera::Fps;
+    v4l2_fract interval { 1, (uint32_t)std::max(1, Setup::Camera::Fps) };
+
+    v4l2_frmivalenum frameInterval {};
+    frameInterval.pixel_format = fourcc;
+    frameInterval.width = size.width;
+    frameInterval.height = size.height;
+
+    double bestFpsError = -1;
+
+    for (frameInterval.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &frameInterval) == 0; ++frameInterval.index)
+    {
+        if (frameInterval.type != V4L2_FRMIVAL_TYPE_DISCRETE)
+        {
+            // Stepwise or continuous - request the frame rate directly
+            break;
+        }
+
+        double fps = (double)frameInterval.discrete.denominator / frameInterval.discrete.numerator;
+        double error = std::abs(fps - requestedFps);
+
+        if (bestFpsError < 0 || error < bestFpsError)
+        {
+            bestFpsError = error;
+            interval = frameInterval.discrete;
+        }
+    }
+
+    // Apply the format
+    v4l2_format format {};
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    format.fmt.pix.width = size.width;
+    format.fmt.pix.height = size.height;
+    format.fmt.pix.pixelformat = fourcc;
+    format.fmt.pix.field = V4L2_FIELD_NONE;
+
+    if (xioctl(fd, VIDIOC_S_FMT, &format) < 0)
+    {
+        _logger->error("VIDIOC_S_FMT failed: {0}", std::strerror(errno));
+        return false;
+    }
+
+    // The driver may adjust the format, so use what it reports back
+    if (!PixelFormatFromFourcc(format.fmt.pix.pixelformat, _format))
+    {
+        _logger->error("Unsupported pixel format {0}", FourccToString(format.fmt.pix.pixelformat));
+        return false;
+    }
+
+    _size = cv::Size(format.fmt.pix.width, format.fmt.pix.height);
+    _bytesPerLine = format.fmt.pix.bytesperline;
+
+    // Apply the frame rate
+    v4l2_streamparm parameters {};
+    parameters.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parameters.parm.capture.timeperframe = interval;
+
+    if (xioctl(fd, VIDIOC_S_PARM, &parameters) < 0)
+    {
+        _logger->warn("VIDIOC_S_PARM failed: {0}", std::strerror(errno));
+    }
+
+    if (xioctl(fd, VIDIOC_G_PARM, &parameters) == 0 && parameters.parm.capture.timeperframe.numerator > 0)
+    {
+        _frameRate = (double)parameters.parm.capture.timeperframe.denominator / parameters.parm.capture.timeperframe.numerator;
+    }
+    else
+    {
+        _frameRate = (double)interval.denominator / interval.numerator;
+    }
+
+    _logger->info("Camera mode {0}x{1}@{2} {3} (requested {4}x{5}@{6} {7})",
+        _size.width, _size.height, _frameRate, FourccToString(format.fmt.pix.pixelformat),
+        Setup::Camera::Width, Setup::Camera::Height, Setup::Camera::Fps, Setup::Camera::PixelFormat);
+
+    return true;
+}
+
+bool V4L2FrameSource::RequestBuffers()
+{
+    v4l2_requestbuffers request {};
+    request.count = BufferCount;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(_device->fd, VIDIOC_REQBUFS, &request) < 0 || request.count < 2)
+    {
+        _logger->error("VIDIOC_REQBUFS failed: {0}", std::strerror(errno));
+        return false;
+    }
+
+    for (unsigned int i = 0; i < request.count; ++i)
+    {
+        v4l2_buffer buf {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+
+        if (xioctl(_device->fd, VIDIOC_QUERYBUF, &buf) < 0)
+        {
+            _logger->error("VIDIOC_QUERYBUF failed: {0}", std::strerror(errno));
+            return false;
+        }
+
+        void* start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, _device->fd, buf.m.offset);
+
+        if (start == MAP_FAILED)
+        {
+            _logger->error("mmap failed: {0}", std::strerror(errno));
+            return false;
+        }
+
+        _device->buffers.push_back(std::make_pair(start, (size_t)buf.length));
+
+        if (xioctl(_device->fd, VIDIOC_QBUF, &buf) < 0)
+        {
+            _logger->error("VIDIOC_QBUF failed: {0}", std::strerror(errno));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void V4L2FrameSource::ApplyControls()
+{
+    _controlsGeneration = Setup::GetGeneration();
+
+    // Alternating exposures are set by hand, so they can't be left to the camera
+    bool manualExposure = !Setup::Camera::AutoExposure || Setup::Camera::TargetFramesPerDriverFrame > 0;
+
+    if (Setup::Camera::AutoExposure && manualExposure)
+    {
+        _logger->warn("Auto exposure is off while exposures alternate");
+    }
+
+    // Automatic modes first - the manual values can't be set while they are on
+    ApplyControl(V4L2_CID_EXPOSURE_AUTO, manualExposure ? V4L2_EXPOSURE_MANUAL : V4L2_EXPOSURE_AUTO);
+    ApplyControl(V4L2_CID_AUTOGAIN, Setup::Camera::AutoGain);
+    ApplyControl(V4L2_CID_AUTO_WHITE_BALANCE, Setup::Camera::AutoWhiteBalance);
+
+    if (manualExposure)
+    {
+        ApplyControl(V4L2_CID_EXPOSURE, Setup::Camera::Exposure);
+    }
+
+    if (!Setup::Camera::AutoGain)
+    {
+        ApplyControl(V4L2_CID_GAIN, Setup::Camera::Gain);
+    }
+
+    ApplyControl(V4L2_CID_CONTRAST, Setup::Camera::Contrast);
+    ApplyControl(V4L2_CID_HFLIP, Setup::Camera::HorizontalFlip);
+    ApplyControl(V4L2_CID_VFLIP, Setup::Camera::VerticalFlip);
+}
+
+void V4L2FrameSource::UpdateControls()
+{
+    if (_controlsGeneration == Setup::GetGeneration())
+    {
+        return;
+    }
+
+    _logger->info("Setup reloaded - applying controls to {0}", _path);
+
+    ApplyControls();
+
+    // ApplyControls sets the target exposure - put the driver exposure back if the schedule is on it
+    if (Setup::Camera::TargetFramesPerDriverFrame <= 0)
+    {
+        _appliedExposure = ExposureClass::TargetExposure;
+    }
+    else if (_appliedExposure == ExposureClass::DriverExposure)
+    {
+        SetControl(V4L2_CID_EXPOSURE, Setup::Camera::DriverExposure);
+    }
+}
+
+bool V4L2FrameSource::ApplyControl(uint32_t id, int value)
+{
+    v4l2_queryctrl query {};
+    query.id = id;
+
+    if (xioctl(_device->fd, VIDIOC_QUERYCTRL, &query) < 0 || (query.flags & V4L2_CTRL_FLAG_DISABLED))
+    {
+        _logger->debug("{0} has no control {1:#x}", _path, id);
+        return false;
+    }
+
+    std::string name(reinterpret_cast<const char*>(query.name));
+
+    int clamped = std::max(query.minimum, std::min(query.maximum, value));
+
+    if (clamped != value)
+    {
+        _logger->warn("{0} {1} is out of range {2} to {3} - using {4}", name, value, query.minimum, query.maximum, clamped);
+    }
+
+    if (!SetControl(id, clamped))
+    {
+        return false;
+    }
+
+    // Some drivers accept a value without applying it
+    v4l2_control control {};
+    control.id = id;
+
+    if (xioctl(_device->fd, VIDIOC_G_CTRL, &control) < 0)
+    {
+        _logger->warn("Failed to read back {0}: {1}", name, std::strerror(errno));
+        return false;
+    }
+
+    if (control.value != clamped)
+    {
+        _logger->error("{0} set to {1} but reads back {2}", name, clamped, control.value);
+        return false;
+    }
+
+    _logger->debug("{0} = {1}", name, control.value);
+
+    return true;
+}
+
+bool V4L2FrameSource::SetControl(uint32_t id, int value)
+{
+    v4l2_control control {};
+    control.id = id;
+    control.value = value;
+
+    if (xioctl(_device->fd, VIDIOC_S_CTRL, &control) < 0)
+    {
+        _logger->warn("Failed to set control {0:#x} to {1}: {2}", id, value, std::strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+ExposureClass V4L2FrameSource::ScheduledExposure(uint32_t sequence) const
+{
+    int targetFrames = Setup::Camera::TargetFramesPerDriverFrame;
+
+    if (targetFrames <= 0 || !_scheduleStarted || sequence < _scheduleStart)
+    {
+        return ExposureClass::TargetExposure;
+    }
+
+    // Every (N + 1)th frame is a driver frame
+    return (sequence - _scheduleStart) % (targetFrames + 1) == (uint32_t)targetFrames ? ExposureClass::DriverExposure : ExposureClass::TargetExposure;
+}
+
+void V4L2FrameSource::UpdateExposure(uint32_t sequence)
+{
+    if (Setup::Camera::TargetFramesPerDriverFrame <= 0)
+    {
+        return;
+    }
+
+    // The sensor is already exposing the next few frames, so a new exposure takes effect
+    // ExposureLatencyFrames after the frame just dequeued. The schedule starts there.
+    uint32_t latency = std::max(1, Setup::Camera::ExposureLatencyFrames);
+
+    if (!_scheduleStarted)
+    {
+        _scheduleStarted = true;
+        _scheduleStart = sequence + latency;
+    }
+
+    ExposureClass next = ScheduledExposure(sequence + latency);
+
+    if (next != _appliedExposure)
+    {
+        SetControl(V4L2_CID_EXPOSURE, next == ExposureClass::DriverExposure ? Setup::Camera::DriverExposure : Setup::Camera::Exposure);
+        _appliedExposure = next;
+    }
+}
+
+bool V4L2FrameSource::IsOpened() const
+{
+    return _device && _device->streaming;
+}
+
+bool V4L2FrameSource::Dequeue(v4l2_buffer& buf)
+{
+    // Wait for the driver to fill a buffer
+    pollfd fds { _device->fd, POLLIN, 0 };
+
+    int result;
+
+    do
+    {
+        result = poll(&fds, 1, ReadTimeoutMs);
+    } while (result == -1 && errno == EINTR);
+
+    if (result <= 0)
+    {
+        _logger->error("Timed out waiting for frame from {0}", _path);
+        return false;
+    }
+
+    buf = v4l2_buffer {};
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(_device->fd, VIDIOC_DQBUF, &buf) < 0)
+    {
+        _logger->error("VIDIOC_DQBUF failed: {0}", std::strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool V4L2FrameSource::Read(Frame& frame)
+{
+    if (!IsOpened())
+    {
+        return false;
+    }
+
+    UpdateControls();
+
+    v4l2_buffer buf;
+
+    // Buffers the driver flags as corrupt go straight back to it
+    for (int skipped = 0; ; ++skipped)
+    {
+        if (!Dequeue(buf))
+        {
+            return false;
+        }
+
+        if (!(buf.flags & V4L2_BUF_FLAG_ERROR))
+        {
+            break;
+        }
+
+        _device->Requeue(buf.index);
+
+        if (skipped >= MaxErrorBuffers)
+        {
+            _logger->error("Too many corrupt frames from {0}", _path);
+            return false;
+        }
+
+        _logger->debug("Skipping frame {0} flagged as corrupt by the driver", buf.sequence);
+    }
+
+    void* data = _device->buffers[buf.index].first;
+
+    // Wrap the driver buffer without copying
+    switch (_format)
+    {
+        case PixelFormat::MJPG:
+            frame.image = cv::Mat(1, buf.bytesused, CV_8UC1, data);
+            break;
+        case PixelFormat::YUYV:
+            frame.image = cv::Mat(_size, CV_8UC2, data, _bytesPerLine);
+            break;
+        case PixelFormat::GREY:
+            frame.image = cv::Mat(_size, CV_8UC1, data, _bytesPerLine);
+            break;
+        default:
+            frame.image = cv::Mat(_size, CV_8UC3, data, _bytesPerLine);
+            break;
+    }
+
+    frame.format = _format;
+    frame.sequence = buf.sequence;
+    frame.deviceSequence = true;
+
+    frame.exposure = ScheduledExposure(buf.sequence);
+    UpdateExposure(buf.sequence);
+
+    // Use driver timestamps when they are on the same clock as steady_clock
+    if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+    {
+        frame.timestamp = std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::seconds(buf.timestamp.tv_sec) + std::chrono::microseconds(buf.timestamp.tv_usec)));
+
+        // Most drivers, UVC included, stamp the end of the frame rather than the start of exposure -
+        // move those back by the frame period it took to read out
+        if ((buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK) == V4L2_BUF_FLAG_TSTAMP_SRC_EOF && _frameRate > 0)
+        {
+            frame.timestamp -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / _frameRate));
+        }
+    }
+    else
+    {
+        frame.timestamp = std::chrono::steady_clock::now();
+    }
+
+    // Hand the buffer back to the driver once the frame is released
+    std::shared_ptr<Device> device = _device;
+    unsigned int index = buf.index;
+
+    frame.buffer = std::shared_ptr<void>(data, [device, index](void*) { device->Requeue(index); });
+
+    return true;
+}
+
+void V4L2FrameSource::Release()
+{
+    if (!_device)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_device->mutex);
+
+        if (_device->streaming)
+        {
+            v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            xioctl(_device->fd, VIDIOC_STREAMOFF, &type);
+            _device->streaming = false;
+        }
+    }
+
+    // Buffers stay mapped until every outstanding frame is released
+    _device.reset();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <memory>
+
+#include "spdlog/spdlog.h"
+
+#include "FrameSource.h"
+
+struct v4l2_buffer;
+
+namespace Lightning
+{
+
+// Captures directly from a V4L2 device using mmap'd driver buffers. Each frame wraps a
+// dequeued buffer without copying, and the buffer is requeued when the frame is released.
+class V4L2FrameSource : public FrameSource
+{
+public:
+
+    V4L2FrameSource(std::vector<spdlog::sink_ptr>, int);
+    ~V4L2FrameSource();
+
+    virtual bool Open();
+
+    virtual bool IsOpened() const;
+
+    virtual bool Read(Frame&);
+
+    virtual void Release();
+
+    virtual bool IsLive() const { return true; }
+
+    virtual bool CanReconnect() const { return true; }
+
+    virtual cv::Size GetFrameSize() const { return _size; }
+
+    virtual double GetFrameRate() const { return _frameRate; }
+
+private:
+
+    // Device state shared with outstanding frames, so buffers can be requeued safely after the source is released
+    struct Device;
+
+    // Pick the supported mode closest to the Setup camera settings and apply it
+    bool NegotiateFormat();
+
+    bool RequestBuffers();
+
+    // Wait for and dequeue the next filled buffer
+    bool Dequeue(v4l2_buffer&);
+
+    // Apply the Setup camera controls, verifying each by reading it back
+    void ApplyControls();
+
+    // Apply the controls again if the setup file has been reloaded since they were applied
+    void UpdateControls();
+
+    // Set a control within its range and read it back - returns false if unsupported or not applied
+    bool ApplyControl(uint32_t, int);
+
+    bool SetControl(uint32_t, int);
+
+    // Exposure class the schedule assigns to a driver sequence number
+    ExposureClass ScheduledExposure(uint32_t) const;
+
+    // Switch the exposure ahead of the frames that need it
+    void UpdateExposure(uint32_t);
+
+    std::shared_ptr<spdlog::logger> _logger;
+
+    std::shared_ptr<Device> _device;
+
+    std::string _path;
+
+    PixelFormat _format;
+    cv::Size _size;
+    size_t _bytesPerLine;
+    double _frameRate;
+
+    // Setup generation the controls were last applied from
+    uint64_t _controlsGeneration;
+
+    // Alternating exposure schedule, anchored to the driver sequence number after each open
+    bool _scheduleStarted;
+    uint32_t _scheduleStart;
+    ExposureClass _appliedExposure;
+};
+
+}
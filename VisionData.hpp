@@ -3,6 +3,7 @@
 #include "json.hpp"
 
 #include "VisionStatus.hpp"
+#include "CaptureStatistics.hpp"
 
 namespace Lightning
 {
@@ -25,6 +26,11 @@ public:
     double imageY;
     double theta;
     double dist;
+    int64_t captureTime;
+    uint64_t sequence;
+
+    // Republished from an earlier frame because the image had not changed
+    bool reused = false;
 };
 
 inline void to_json(nlohmann::json& j, const VisionData& d) {
@@ -38,7 +44,10 @@ inline void to_json(nlohmann::json& j, const VisionData& d) {
     {"imageX_px", d.imageX}, 
     {"imageY_px", d.imageY}, 
     {"theta_deg", d.theta},
-    {"dist_mm", d.dist}};
+    {"dist_mm", d.dist},
+    {"captureTime_us", d.captureTime},
+    {"sequence", d.sequence},
+    {"reused", d.reused}};
 }
 
 inline void from_json(const nlohmann::json& j, VisionData& d) {
@@ -53,8 +62,9 @@ inline void from_json(const nlohmann::json& j, VisionData& d) {
     j.at("imageY_px").get_to(d.imageY);
     j.at("theta_deg").get_to(d.theta);
     j.at("dist_mm").get_to(d.dist);
-
-
+    j.at("captureTime_us").get_to(d.captureTime);
+    j.at("sequence").get_to(d.sequence);
+    j.at("reused").get_to(d.reused);
 }
 
 class VisionMessage
@@ -63,15 +73,28 @@ public:
     int cameraId;
     std::vector<VisionData> packets;
 
+    // Overall status of the camera for this message
+    VisionStatus status = VisionStatus::NoTargetFound;
+
+    // Monotonic capture time and sequence number of the frame the packets came from
+    int64_t captureTime = 0;
+    uint64_t sequence = 0;
+
+    // Capture timing for the camera's latest reporting window
+    CaptureStatistics capture;
 };
 
 inline void to_json(nlohmann::json& j, const VisionMessage& d) {
-    j = nlohmann::json{{"cameraId", (int)d.cameraId}, {"packets", d.packets}};
+    j = nlohmann::json{{"cameraId", (int)d.cameraId}, {"status", (int)d.status}, {"packets", d.packets}, {"captureTime_us", d.captureTime}, {"sequence", d.sequence}, {"capture", d.capture}};
 }
 
 inline void from_json(const nlohmann::json& j, VisionMessage& d) {
     j.at("cameraId").get_to(d.cameraId);
+    j.at("status").get_to(d.status);
     j.at("packets").get_to(d.packets);
+    j.at("captureTime_us").get_to(d.captureTime);
+    j.at("sequence").get_to(d.sequence);
+    j.at("capture").get_to(d.capture);
 }
 
 }
\ No newline at end of file